@@ -0,0 +1,91 @@
+#ifndef BENCHMAIN_H
+#define BENCHMAIN_H
+
+#include <QtCore/QAbstractEventDispatcher>
+#include <QtCore/QCoreApplication>
+#include <QtCore/QThread>
+#include <QtTest/QtTest>
+#include <stdio.h>
+#include "eventdispatcher_libevent.h"
+
+/*
+ * The BENCH_DISPATCHER environment variable selects the event dispatcher under test:
+ *   libevent (default) - EventDispatcherLibEvent
+ *   native             - Qt's own dispatcher: the glib one if Qt is built with glib,
+ *                        the UNIX one otherwise or if QT_NO_GLIB=1 is set
+ *
+ * With BENCH_PRINT_DISPATCHER set, the benchmark prints the class name of the selected
+ * dispatcher instead of running (run.sh labels the results with it)
+ */
+static inline bool benchUsesLibEvent(void)
+{
+	return qgetenv("BENCH_DISPATCHER") != "native";
+}
+
+/**
+ * @return Dispatcher to install into a new thread; 0 if Qt should create its own
+ */
+static inline QAbstractEventDispatcher* benchCreateDispatcher(void)
+{
+	return benchUsesLibEvent() ? new EventDispatcherLibEvent() : 0;
+}
+
+static inline void benchInstallDispatcher(QThread* thread)
+{
+#if QT_VERSION >= 0x050000
+	QAbstractEventDispatcher* dispatcher = benchCreateDispatcher();
+	if (dispatcher) {
+		thread->setEventDispatcher(dispatcher);
+	}
+#else
+	// Qt 4 has no way to install a dispatcher into another thread
+	Q_UNUSED(thread)
+#endif
+}
+
+#if QT_VERSION >= 0x050000
+#	define BENCH_INSTALL_MAIN_DISPATCHER() \
+		do { \
+			QAbstractEventDispatcher* dispatcher = benchCreateDispatcher(); \
+			if (dispatcher) { \
+				QCoreApplication::setEventDispatcher(dispatcher); \
+			} \
+		} while (0)
+#else
+	// A dispatcher created before QCoreApplication becomes the dispatcher of the main thread
+#	define BENCH_INSTALL_MAIN_DISPATCHER() benchCreateDispatcher()
+#endif
+
+#if QT_VERSION >= 0x050000
+#	define BENCH_SKIP(message) QSKIP(message)
+#else
+#	define BENCH_SKIP(message) QSKIP(message, SkipSingle)
+#endif
+
+/**
+ * @return Whether the benchmark only has to print the class name of the dispatcher of the main thread
+ */
+static inline bool benchPrintDispatcher(void)
+{
+	if (qgetenv("BENCH_PRINT_DISPATCHER").isEmpty()) {
+		return false;
+	}
+
+	QAbstractEventDispatcher* dispatcher = QAbstractEventDispatcher::instance();
+	printf("%s\n", dispatcher ? dispatcher->metaObject()->className() : "none");
+	return true;
+}
+
+#define BENCH_MAIN(TestObject) \
+	int main(int argc, char** argv) \
+	{ \
+		BENCH_INSTALL_MAIN_DISPATCHER(); \
+		QCoreApplication app(argc, argv); \
+		if (benchPrintDispatcher()) { \
+			return 0; \
+		} \
+		TestObject tc; \
+		return QTest::qExec(&tc, argc, argv); \
+	}
+
+#endif // BENCHMAIN_H
@@ -0,0 +1,2 @@
+TEMPLATE = subdirs
+SUBDIRS  = timers socknot wakeup loop
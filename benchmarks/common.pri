@@ -0,0 +1,24 @@
+QT      -= gui
+QT      += testlib
+CONFIG  += console testcase
+CONFIG  -= app_bundle
+DESTDIR  = ..
+
+INCLUDEPATH += $$PWD $$PWD/../src
+DEPENDPATH  += $$PWD $$PWD/../src
+
+HEADERS += $$PWD/benchmain.h
+
+CONFIG  *= link_prl
+LIBS    += -L$$OUT_PWD/$$DESTDIR/../lib -leventdispatcher_libevent
+
+unix|*-g++* {
+    equals(QMAKE_PREFIX_STATICLIB, ""): QMAKE_PREFIX_STATICLIB = lib
+    equals(QMAKE_EXTENSION_STATICLIB, ""): QMAKE_EXTENSION_STATICLIB = a
+
+    PRE_TARGETDEPS *= $$OUT_PWD/$$DESTDIR/../lib/$${QMAKE_PREFIX_STATICLIB}eventdispatcher_libevent$${LIB_SUFFIX}.$${QMAKE_EXTENSION_STATICLIB}
+}
+else:win32 {
+    PRE_TARGETDEPS *= $$OUT_PWD/$$DESTDIR/../lib/eventdispatcher_libevent$${LIB_SUFFIX}.lib
+    LIBS           += $$QMAKE_LIBS_NETWORK
+}
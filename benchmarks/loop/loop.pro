@@ -0,0 +1,4 @@
+TARGET  = tst_bench_loop
+SOURCES = tst_bench_loop.cpp
+
+include(../common.pri)
@@ -0,0 +1,117 @@
+#include <QtCore/QEventLoop>
+#include <QtCore/QSocketNotifier>
+#include <QtCore/QTimer>
+#include <QtCore/QVector>
+#include "benchmain.h"
+
+#ifndef Q_OS_WIN
+#	include <sys/socket.h>
+#	include <unistd.h>
+#endif
+
+class Counter : public QObject {
+	Q_OBJECT
+public:
+	Counter(void) : QObject(), count(0) {}
+
+	int count;
+
+public Q_SLOTS:
+	void tick(void) { ++this->count; }
+};
+
+class tst_BenchLoop : public QObject {
+	Q_OBJECT
+private Q_SLOTS:
+	void idle(void);
+	void idleWithWatchers(void);
+	void busyTimers(void);
+	void busyPostedEvents(void);
+};
+
+/*
+ * Nothing to do: the cost of one non-blocking iteration
+ */
+void tst_BenchLoop::idle(void)
+{
+	QBENCHMARK {
+		QCoreApplication::processEvents(QEventLoop::AllEvents);
+	}
+}
+
+/*
+ * Nothing to do, but 1000 idle descriptors and 1000 far timers are registered
+ */
+void tst_BenchLoop::idleWithWatchers(void)
+{
+#ifdef Q_OS_WIN
+	BENCH_SKIP("Not implemented on Windows");
+#else
+	QVector<int> fds;
+	QList<QSocketNotifier*> notifiers;
+	for (int i=0; i<500; ++i) {
+		int sv[2];
+		if (-1 == ::socketpair(AF_UNIX, SOCK_STREAM, 0, sv)) {
+			break;
+		}
+
+		fds << sv[0] << sv[1];
+		notifiers << new QSocketNotifier(sv[0], QSocketNotifier::Read) << new QSocketNotifier(sv[1], QSocketNotifier::Read);
+	}
+
+	QObject object;
+	for (int i=0; i<1000; ++i) {
+		object.startTimer(60000 + i);
+	}
+
+	QBENCHMARK {
+		QCoreApplication::processEvents(QEventLoop::AllEvents);
+	}
+
+	qDeleteAll(notifiers);
+	for (int i=0; i<fds.size(); ++i) {
+		::close(fds.at(i));
+	}
+#endif
+}
+
+/*
+ * 100 zero-interval timers fire on every iteration
+ */
+void tst_BenchLoop::busyTimers(void)
+{
+	Counter counter;
+	for (int i=0; i<100; ++i) {
+		QTimer* t = new QTimer(&counter);
+		QObject::connect(t, SIGNAL(timeout()), &counter, SLOT(tick()));
+		t->start(0);
+	}
+
+	QBENCHMARK {
+		QCoreApplication::processEvents(QEventLoop::AllEvents);
+	}
+
+	QVERIFY(counter.count > 0);
+}
+
+/*
+ * 100 events are posted before every iteration
+ */
+void tst_BenchLoop::busyPostedEvents(void)
+{
+	Counter counter;
+
+	QBENCHMARK {
+		for (int i=0; i<100; ++i) {
+			QMetaObject::invokeMethod(&counter, "tick", Qt::QueuedConnection);
+		}
+
+		QCoreApplication::processEvents(QEventLoop::AllEvents);
+	}
+
+	QVERIFY(counter.count > 0);
+}
+
+BENCH_MAIN(tst_BenchLoop)
+
+#include "tst_bench_loop.moc"
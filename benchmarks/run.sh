@@ -0,0 +1,38 @@
+#! /bin/sh
+
+# Runs the benchmarks against EventDispatcherLibEvent and Qt's own dispatchers
+# and stores the results as QtTest XML in the directory given as the first argument.
+# The results of Qt's dispatchers are labelled with the dispatcher the benchmark actually got:
+# "glib" or "unix" (QT_NO_GLIB=1 has no effect if Qt is built without glib, and that run is skipped)
+
+set -e
+
+cd "$(dirname "$0")"
+OUT=${1:-results}
+mkdir -p "$OUT"
+
+label()
+{
+	case "$1" in
+		*Glib*) echo glib ;;
+		*UNIX*) echo unix ;;
+		*)      echo "$1" | tr 'A-Z' 'a-z' ;;
+	esac
+}
+
+for i in ./tst_bench_*; do
+	name=$(basename "$i")
+	BENCH_DISPATCHER=libevent "$i" -xml -o "$OUT/$name-libevent.xml" || true
+
+	last=
+	for glib in "" "QT_NO_GLIB=1"; do
+		kind=$(env $glib BENCH_DISPATCHER=native BENCH_PRINT_DISPATCHER=1 "$i") || continue
+		kind=$(label "$kind")
+		if [ "$kind" = "$last" ]; then
+			continue
+		fi
+
+		env $glib BENCH_DISPATCHER=native "$i" -xml -o "$OUT/$name-$kind.xml" || true
+		last=$kind
+	done
+done
@@ -0,0 +1,4 @@
+TARGET  = tst_bench_socknot
+SOURCES = tst_bench_socknot.cpp
+
+include(../common.pri)
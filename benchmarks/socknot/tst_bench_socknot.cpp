@@ -0,0 +1,176 @@
+#include <QtCore/QEventLoop>
+#include <QtCore/QSocketNotifier>
+#include <QtCore/QVector>
+#include "benchmain.h"
+
+#ifdef Q_OS_WIN
+#	include <winsock2.h>
+#else
+#	include <sys/types.h>
+#	include <sys/resource.h>
+#	include <sys/select.h>
+#	include <sys/socket.h>
+#	include <unistd.h>
+#endif
+
+class Reader : public QObject {
+	Q_OBJECT
+public:
+	Reader(void) : QObject(), ready(0) {}
+
+	int ready;
+
+public Q_SLOTS:
+	void activated(int fd)
+	{
+		char c;
+		if (::recv(fd, &c, 1, 0) == 1) {
+			++this->ready;
+		}
+	}
+};
+
+class tst_BenchSocketNotifier : public QObject {
+	Q_OBJECT
+private Q_SLOTS:
+	void readiness_data(void);
+	void readiness(void);
+	void toggle_data(void);
+	void toggle(void);
+	void cleanup(void);
+
+private:
+	QVector<int> m_fds;
+	QVector<QSocketNotifier*> m_notifiers;
+
+	bool createPairs(int count);
+};
+
+/*
+ * Creates @a count socket pairs: m_fds[2*i] is watched, m_fds[2*i+1] is written to
+ */
+bool tst_BenchSocketNotifier::createPairs(int count)
+{
+#ifdef Q_OS_WIN
+	Q_UNUSED(count)
+	return false;
+#else
+#	if QT_VERSION < 0x050700
+	// Qt's own UNIX dispatcher is based on select() and cannot watch descriptors above FD_SETSIZE
+	if (!benchUsesLibEvent() && count * 2 + 64 > FD_SETSIZE) {
+		return false;
+	}
+#	endif
+
+	struct rlimit rl;
+	if (0 == getrlimit(RLIMIT_NOFILE, &rl) && rl.rlim_cur != RLIM_INFINITY && rl.rlim_cur < rlim_t(count) * 2 + 64) {
+		rl.rlim_cur = qMin(rl.rlim_max, rlim_t(count) * 2 + 64);
+		setrlimit(RLIMIT_NOFILE, &rl);
+		if (rl.rlim_cur < rlim_t(count) * 2 + 64) {
+			return false;
+		}
+	}
+
+	this->m_fds.resize(count * 2);
+	for (int i=0; i<count; ++i) {
+		if (-1 == ::socketpair(AF_UNIX, SOCK_STREAM, 0, this->m_fds.data() + 2 * i)) {
+			this->m_fds.resize(2 * i);
+			return false;
+		}
+	}
+
+	return true;
+#endif
+}
+
+void tst_BenchSocketNotifier::cleanup(void)
+{
+	qDeleteAll(this->m_notifiers);
+	this->m_notifiers.clear();
+
+#ifndef Q_OS_WIN
+	for (int i=0; i<this->m_fds.size(); ++i) {
+		::close(this->m_fds.at(i));
+	}
+#endif
+
+	this->m_fds.clear();
+}
+
+void tst_BenchSocketNotifier::readiness_data(void)
+{
+	QTest::addColumn<int>("count");
+	QTest::newRow("10") << 10;
+	QTest::newRow("1k") << 1000;
+	QTest::newRow("50k") << 50000;
+}
+
+/*
+ * One round: every descriptor becomes readable, the event loop runs until every notifier has been activated
+ */
+void tst_BenchSocketNotifier::readiness(void)
+{
+	QFETCH(int, count);
+
+	if (!this->createPairs(count)) {
+		BENCH_SKIP("Cannot create enough socket pairs");
+	}
+
+	Reader reader;
+	for (int i=0; i<count; ++i) {
+		QSocketNotifier* n = new QSocketNotifier(this->m_fds.at(2 * i), QSocketNotifier::Read);
+		QObject::connect(n, SIGNAL(activated(int)), &reader, SLOT(activated(int)));
+		this->m_notifiers.append(n);
+	}
+
+	QBENCHMARK {
+		reader.ready = 0;
+		for (int i=0; i<count; ++i) {
+			::send(this->m_fds.at(2 * i + 1), "x", 1, 0);
+		}
+
+		while (reader.ready < count) {
+			QCoreApplication::processEvents(QEventLoop::WaitForMoreEvents);
+		}
+	}
+}
+
+void tst_BenchSocketNotifier::toggle_data(void)
+{
+	QTest::addColumn<int>("count");
+	QTest::newRow("10") << 10;
+	QTest::newRow("1k") << 1000;
+	QTest::newRow("50k") << 50000;
+}
+
+/*
+ * Notifiers of idle descriptors are disabled and enabled back, as QAbstractSocket does on every read
+ */
+void tst_BenchSocketNotifier::toggle(void)
+{
+	QFETCH(int, count);
+
+	if (!this->createPairs(count)) {
+		BENCH_SKIP("Cannot create enough socket pairs");
+	}
+
+	for (int i=0; i<count; ++i) {
+		this->m_notifiers.append(new QSocketNotifier(this->m_fds.at(2 * i), QSocketNotifier::Read));
+	}
+
+	QBENCHMARK {
+		for (int i=0; i<count; ++i) {
+			this->m_notifiers.at(i)->setEnabled(false);
+		}
+
+		for (int i=0; i<count; ++i) {
+			this->m_notifiers.at(i)->setEnabled(true);
+		}
+
+		QCoreApplication::processEvents(QEventLoop::AllEvents);
+	}
+}
+
+BENCH_MAIN(tst_BenchSocketNotifier)
+
+#include "tst_bench_socknot.moc"
@@ -0,0 +1,4 @@
+TARGET  = tst_bench_timers
+SOURCES = tst_bench_timers.cpp
+
+include(../common.pri)
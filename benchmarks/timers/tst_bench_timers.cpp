@@ -0,0 +1,244 @@
+#include <QtCore/QElapsedTimer>
+#include <QtCore/QEventLoop>
+#include <QtCore/QVector>
+#include <time.h>
+#include "benchmain.h"
+
+class TimerObject : public QObject {
+public:
+	TimerObject(void) : QObject(), fired(0), lateness(0), m_interval(0), m_started(), m_expected() {}
+
+	int fired;
+	qint64 lateness; ///< Sum over all fired timer events (msec)
+
+	void start(int count, int interval)
+	{
+		this->m_interval = interval;
+		this->m_started.start();
+		this->m_expected.clear();
+		for (int i=0; i<count; ++i) {
+			int id = this->startTimer(interval);
+			if (id >= this->m_expected.size()) {
+				this->m_expected.resize(id + 1);
+			}
+
+			this->m_expected[id] = interval;
+		}
+	}
+
+protected:
+	virtual void timerEvent(QTimerEvent* e)
+	{
+		++this->fired;
+
+		qint64 now      = this->m_started.elapsed();
+		qint64& due     = this->m_expected[e->timerId()];
+		this->lateness += qMax(now - due, qint64(0));
+		due             = now + this->m_interval;
+	}
+
+private:
+	int m_interval;
+	QElapsedTimer m_started;
+	QVector<qint64> m_expected;
+};
+
+class TimerCounter : public QObject {
+public:
+	TimerCounter(void) : QObject(), fired(0) {}
+
+	qint64 fired;
+
+protected:
+	virtual void timerEvent(QTimerEvent*)
+	{
+		++this->fired;
+	}
+};
+
+class tst_BenchTimers : public QObject {
+	Q_OBJECT
+private Q_SLOTS:
+	void registerUnregister_data(void);
+	void registerUnregister(void);
+	void fireThroughput_data(void);
+	void fireThroughput(void);
+	void lateness_data(void);
+	void lateness(void);
+	void heapVersusWheel_data(void);
+	void heapVersusWheel(void);
+	void simulatedDay_data(void);
+	void simulatedDay(void);
+};
+
+void tst_BenchTimers::registerUnregister_data(void)
+{
+	QTest::addColumn<int>("count");
+	QTest::newRow("1k") << 1000;
+	QTest::newRow("100k") << 100000;
+	QTest::newRow("1M") << 1000000;
+}
+
+void tst_BenchTimers::registerUnregister(void)
+{
+	QFETCH(int, count);
+
+	QObject object;
+	QVector<int> ids(count);
+
+	QBENCHMARK {
+		for (int i=0; i<count; ++i) {
+			ids[i] = object.startTimer(1000 + i % 1000);
+		}
+
+		for (int i=0; i<count; ++i) {
+			object.killTimer(ids.at(i));
+		}
+	}
+}
+
+void tst_BenchTimers::fireThroughput_data(void)
+{
+	QTest::addColumn<int>("count");
+	QTest::newRow("1") << 1;
+	QTest::newRow("100") << 100;
+	QTest::newRow("10k") << 10000;
+}
+
+/*
+ * Zero-interval timers fire on every iteration: the cost of one timer event
+ * is the cost of one iteration divided by the number of timers
+ */
+void tst_BenchTimers::fireThroughput(void)
+{
+	QFETCH(int, count);
+
+	TimerObject object;
+	object.start(count, 0);
+
+	const int events = qMax(count * 10, 10000);
+	QBENCHMARK {
+		object.fired = 0;
+		while (object.fired < events) {
+			QCoreApplication::processEvents(QEventLoop::AllEvents);
+		}
+	}
+}
+
+void tst_BenchTimers::lateness_data(void)
+{
+	QTest::addColumn<int>("count");
+	QTest::addColumn<int>("interval");
+	QTest::newRow("1x1ms") << 1 << 1;
+	QTest::newRow("1000x1ms") << 1000 << 1;
+	QTest::newRow("1000x10ms") << 1000 << 10;
+	QTest::newRow("10000x20ms") << 10000 << 20;
+}
+
+/*
+ * Average delay between the time a timer is due and the delivery of its event;
+ * reported instead of the run time
+ */
+void tst_BenchTimers::lateness(void)
+{
+	QFETCH(int, count);
+	QFETCH(int, interval);
+
+	TimerObject object;
+	object.start(count, interval);
+
+	QElapsedTimer t;
+	t.start();
+	while (t.elapsed() < 500) {
+		QCoreApplication::processEvents(QEventLoop::WaitForMoreEvents);
+	}
+
+	QVERIFY(object.fired > 0);
+	QTest::setBenchmarkResult(qreal(object.lateness) / object.fired, QTest::WalltimeMilliseconds);
+}
+
+void tst_BenchTimers::heapVersusWheel_data(void)
+{
+	QTest::addColumn<int>("count");
+	QTest::addColumn<int>("type");
+#if QT_VERSION >= 0x050000
+	QTest::newRow("1k precise") << 1000 << int(Qt::PreciseTimer);
+	QTest::newRow("1k coarse") << 1000 << int(Qt::CoarseTimer);
+	QTest::newRow("10k precise") << 10000 << int(Qt::PreciseTimer);
+	QTest::newRow("10k coarse") << 10000 << int(Qt::CoarseTimer);
+#endif
+}
+
+/*
+ * The same timer load served by libevent's heap (precise timers) and by the timer wheel (coarse timers):
+ * every timer event reschedules its timer. The CPU time spent on a fixed number of events is reported
+ * instead of the run time, which is dominated by sleeping
+ */
+void tst_BenchTimers::heapVersusWheel(void)
+{
+#if QT_VERSION >= 0x050000
+	QFETCH(int, count);
+	QFETCH(int, type);
+
+	TimerCounter counter;
+	for (int i=0; i<count; ++i) {
+		counter.startTimer(25 + i % 50, Qt::TimerType(type));
+	}
+
+	const qint64 events = qint64(count) * 20;
+	clock_t start       = clock();
+	while (counter.fired < events) {
+		QCoreApplication::processEvents(QEventLoop::WaitForMoreEvents);
+	}
+
+	clock_t spent = clock() - start;
+	QTest::setBenchmarkResult(qreal(spent) * 1000 / CLOCKS_PER_SEC, QTest::WalltimeMilliseconds);
+#else
+	BENCH_SKIP("Timer types need Qt 5");
+#endif
+}
+
+void tst_BenchTimers::simulatedDay_data(void)
+{
+	QTest::addColumn<int>("count");
+	QTest::addColumn<int>("min");
+	QTest::addColumn<int>("max");
+	QTest::newRow("10k x 1-60s") << 10000 << 1000 << 60000;
+	QTest::newRow("1M x 10-60min") << 1000000 << 600000 << 3600000;
+}
+
+/*
+ * 24 hours of timer traffic replayed on the virtual clock, one virtual minute per step
+ */
+void tst_BenchTimers::simulatedDay(void)
+{
+	QFETCH(int, count);
+	QFETCH(int, min);
+	QFETCH(int, max);
+
+	EventDispatcherLibEvent* dispatcher = qobject_cast<EventDispatcherLibEvent*>(QAbstractEventDispatcher::instance());
+	if (!dispatcher) {
+		BENCH_SKIP("Virtual clock is specific to EventDispatcherLibEvent");
+	}
+
+	static const qint64 minute = Q_INT64_C(60000000);
+
+	TimerCounter counter;
+	dispatcher->setVirtualClock(0);
+	for (int i=0; i<count; ++i) {
+		counter.startTimer(min + i % (max - min + 1));
+	}
+
+	QBENCHMARK_ONCE {
+		for (int i=0; i<24*60; ++i) {
+			dispatcher->advanceClock(minute);
+		}
+	}
+
+	dispatcher->setClock(0);
+	QVERIFY(counter.fired > 0);
+}
+
+BENCH_MAIN(tst_BenchTimers)
+
+#include "tst_bench_timers.moc"
@@ -0,0 +1,114 @@
+#include <QtCore/QEvent>
+#include <QtCore/QEventLoop>
+#include <QtCore/QThread>
+#include "benchmain.h"
+
+static const QEvent::Type PingEvent = static_cast<QEvent::Type>(QEvent::User + 1);
+
+/*
+ * Sends every ping back to the sender
+ */
+class Ponger : public QObject {
+public:
+	explicit Ponger(QObject* peer) : QObject(), m_peer(peer) {}
+
+protected:
+	virtual bool event(QEvent* e)
+	{
+		if (e->type() == PingEvent) {
+			QCoreApplication::postEvent(this->m_peer, new QEvent(PingEvent));
+			return true;
+		}
+
+		return QObject::event(e);
+	}
+
+private:
+	QObject* m_peer;
+};
+
+class Pinger : public QObject {
+public:
+	Pinger(void) : QObject(), received(0) {}
+
+	int received;
+
+protected:
+	virtual bool event(QEvent* e)
+	{
+		if (e->type() == PingEvent) {
+			++this->received;
+			return true;
+		}
+
+		return QObject::event(e);
+	}
+};
+
+class tst_BenchWakeUp : public QObject {
+	Q_OBJECT
+private Q_SLOTS:
+	void initTestCase(void);
+	void cleanupTestCase(void);
+	void pingPong(void);
+	void wakeUpBusy(void);
+
+private:
+	QThread m_thread;
+	Pinger m_pinger;
+	Ponger* m_ponger;
+};
+
+void tst_BenchWakeUp::initTestCase(void)
+{
+	benchInstallDispatcher(&this->m_thread);
+
+	this->m_ponger = new Ponger(&this->m_pinger);
+	this->m_ponger->moveToThread(&this->m_thread);
+	QObject::connect(&this->m_thread, SIGNAL(finished()), this->m_ponger, SLOT(deleteLater()));
+	this->m_thread.start();
+}
+
+void tst_BenchWakeUp::cleanupTestCase(void)
+{
+	this->m_thread.quit();
+	this->m_thread.wait();
+}
+
+/*
+ * Round trip of a posted event to a thread blocked in its event loop and back
+ */
+void tst_BenchWakeUp::pingPong(void)
+{
+	static const int rounds = 1000;
+
+	QBENCHMARK {
+		for (int i=0; i<rounds; ++i) {
+			this->m_pinger.received = 0;
+			QCoreApplication::postEvent(this->m_ponger, new QEvent(PingEvent));
+			while (!this->m_pinger.received) {
+				QCoreApplication::processEvents(QEventLoop::WaitForMoreEvents);
+			}
+		}
+	}
+}
+
+/*
+ * Cost of QAbstractEventDispatcher::wakeUp() for the producer when the target thread
+ * is already awake: the descriptor does not need to be signalled again
+ */
+void tst_BenchWakeUp::wakeUpBusy(void)
+{
+	QAbstractEventDispatcher* dispatcher = QAbstractEventDispatcher::instance(&this->m_thread);
+	QVERIFY(dispatcher != 0);
+
+	QBENCHMARK {
+		for (int i=0; i<10000; ++i) {
+			dispatcher->wakeUp();
+		}
+	}
+}
+
+BENCH_MAIN(tst_BenchWakeUp)
+
+#include "tst_bench_wakeup.moc"
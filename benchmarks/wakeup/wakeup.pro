@@ -0,0 +1,4 @@
+TARGET  = tst_bench_wakeup
+SOURCES = tst_bench_wakeup.cpp
+
+include(../common.pri)
@@ -7,7 +7,17 @@ greaterThan(QT_MAJOR_VERSION, 4) {
 	src-gui.file = src-gui/eventdispatcher_libevent_qpa.pro
 }
 
-SUBDIRS += tests
+SUBDIRS += tests allocations notifiers benchmarks
 
-src.file   = src/eventdispatcher_libevent.pro
-tests.file = tests/qt_eventdispatcher_tests/build.pro
+greaterThan(QT_MAJOR_VERSION, 4) {
+	SUBDIRS          += pool migration workstealing
+	pool.file         = tests/pool/pool.pro
+	migration.file    = tests/migration/migration.pro
+	workstealing.file = tests/workstealing/workstealing.pro
+}
+
+src.file         = src/eventdispatcher_libevent.pro
+tests.file       = tests/qt_eventdispatcher_tests/build.pro
+allocations.file = tests/allocations/allocations.pro
+notifiers.file   = tests/notifiers/notifiers.pro
+benchmarks.file  = benchmarks/benchmarks.pro
@@ -0,0 +1,411 @@
+#include "common.h"
+#include <QtCore/QMutexLocker>
+#include <QtCore/QThreadStorage>
+#include <stdlib.h>
+#include <string.h>
+#include "arena_p.h"
+
+/**
+ * @internal
+ * @brief Block sizes of the arena, without the header
+ *
+ * evmap and changelist records fall into the lower classes, <tt>struct event</tt> (80 to 140 bytes,
+ * depending on the platform and libevent version) into 96 to 192.
+ */
+static const size_t size_classes[MemoryArena::ClassCount] = {
+	16, 32, 48, 64, 96, 128, 160, 192, 256, 384, 512, 1024
+};
+
+/**
+ * @internal
+ * @brief Header of every block handed out to libevent; keeps the payload 16-byte aligned
+ */
+union MemoryArena::BlockHeader {
+	struct {
+		MemoryArena* arena;    ///< Owner; 0 if the block was allocated without an arena
+		int size_class;        ///< -1 for blocks allocated by the system allocator
+		quint32 size;          ///< Requested size
+	} h;
+	char align[16];
+};
+
+union MemoryArena::FreeBlock {
+	BlockHeader header;
+	struct {
+		BlockHeader header;
+		FreeBlock* next;
+	} node;
+};
+
+/**
+ * @internal
+ * @brief Owner of the thread's arena; QThreadStorage destroys it when the thread exits
+ */
+struct MemoryArena::Holder {
+	MemoryArena* arena;        ///< Arena of the thread itself; 0 until the thread allocates without a bound arena
+	MemoryArena* bound;        ///< Arena of the dispatcher run by the thread, see bind(); owned by the dispatcher
+
+	Holder(void) : arena(0), bound(0) {}
+	~Holder(void);
+};
+
+namespace {
+
+struct ArenaRegistry {
+	QMutex lock;
+	MemoryArena* idle;
+
+	ArenaRegistry(void) : lock(), idle(0) {}
+};
+
+}
+
+Q_GLOBAL_STATIC(ArenaRegistry, arena_registry)
+Q_GLOBAL_STATIC(QThreadStorage<MemoryArena::Holder*>, arena_storage)
+
+// Set before any thread uses libevent, see install()
+static bool arena_installed = false;
+static bool arena_frozen    = false;
+
+MemoryArena::MemoryArena(void)
+	: m_lock(), m_chunk(0), m_chunk_left(0), m_allocations(0), m_frees(0), m_bytes(0), m_next_idle(0)
+{
+	for (int i=0; i<MemoryArena::ClassCount; ++i) {
+		this->m_free[i] = 0;
+	}
+}
+
+MemoryArena::Holder::~Holder(void)
+{
+	if (this->arena) {
+		MemoryArena::retire(this->arena);
+	}
+}
+
+/**
+ * @brief Makes libevent allocate memory from per-thread arenas
+ * @return Whether the allocator has been installed
+ *
+ * Must be called before libevent allocates anything: blocks allocated by the system
+ * allocator cannot be freed by the arena.
+ */
+bool MemoryArena::install(void)
+{
+#if defined(SJ_LIBEVENT_EMULATION) || defined(_EVENT_DISABLE_MM_REPLACEMENT) || defined(EVENT__DISABLE_MM_REPLACEMENT)
+	return false;
+#else
+	if (isInstalled()) {
+		return true;
+	}
+
+	if (arena_frozen) {
+		qWarning("%s: libevent is already in use, the allocator cannot be replaced", Q_FUNC_INFO);
+		return false;
+	}
+
+	event_set_mem_functions(MemoryArena::malloc_fn, MemoryArena::realloc_fn, MemoryArena::free_fn);
+	arena_installed = true;
+	return true;
+#endif
+}
+
+bool MemoryArena::isInstalled(void)
+{
+	return arena_installed;
+}
+
+/**
+ * @brief Records that libevent has been used: from now on install() fails
+ */
+void MemoryArena::freeze(void)
+{
+	arena_frozen = true;
+}
+
+/**
+ * @return Holder of the calling thread's arenas; 0 if the thread storage is gone
+ */
+MemoryArena::Holder* MemoryArena::holder(void)
+{
+	QThreadStorage<MemoryArena::Holder*>* storage = arena_storage();
+	if (Q_UNLIKELY(!storage)) {
+		return 0;
+	}
+
+	if (Q_LIKELY(storage->hasLocalData())) {
+		return storage->localData();
+	}
+
+	MemoryArena::Holder* h = new MemoryArena::Holder();
+	storage->setLocalData(h);
+	return h;
+}
+
+/**
+ * @return Arena the calling thread allocates from: the one bound by its dispatcher,
+ * or the thread's own one; 0 if the allocator is not installed
+ */
+MemoryArena* MemoryArena::current(void)
+{
+	if (!MemoryArena::isInstalled()) {
+		return 0;
+	}
+
+	MemoryArena::Holder* h = MemoryArena::holder();
+	if (Q_UNLIKELY(!h)) {
+		return 0;
+	}
+
+	if (Q_LIKELY(h->bound != 0)) {
+		return h->bound;
+	}
+
+	if (Q_UNLIKELY(!h->arena)) {
+		h->arena = MemoryArena::acquire();
+	}
+
+	return h->arena;
+}
+
+/**
+ * @brief Makes the calling thread allocate from @a arena
+ * @param arena Arena; 0 to go back to the thread's own arena
+ * @return Arena bound before
+ *
+ * A dispatcher binds its arena around the creation of its event base, which may take place
+ * in another thread, and in the thread which runs it.
+ */
+MemoryArena* MemoryArena::bind(MemoryArena* arena)
+{
+	MemoryArena::Holder* h = MemoryArena::holder();
+	if (Q_UNLIKELY(!h)) {
+		return 0;
+	}
+
+	MemoryArena* prev = h->bound;
+	h->bound          = arena;
+	return prev;
+}
+
+/**
+ * @brief Makes the calling thread stop allocating from @a arena if it is bound to it
+ * @param arena Arena
+ *
+ * Does not set up the thread storage: the thread may be exiting.
+ */
+void MemoryArena::unbind(MemoryArena* arena)
+{
+	QThreadStorage<MemoryArena::Holder*>* storage = arena_storage();
+	if (storage && storage->hasLocalData() && storage->localData()->bound == arena) {
+		storage->localData()->bound = 0;
+	}
+}
+
+/**
+ * @brief Hands @a arena over to the next thread or dispatcher which needs one
+ * @param arena Arena no longer used for new allocations; the blocks still in use stay valid
+ */
+void MemoryArena::retire(MemoryArena* arena)
+{
+	ArenaRegistry* registry = arena_registry();
+	if (registry) {
+		QMutexLocker locker(&registry->lock);
+		arena->m_next_idle = registry->idle;
+		registry->idle     = arena;
+	}
+}
+
+/**
+ * @return An idle arena or a new one
+ */
+MemoryArena* MemoryArena::acquire(void)
+{
+	ArenaRegistry* registry = arena_registry();
+	if (registry) {
+		QMutexLocker locker(&registry->lock);
+		MemoryArena* arena = registry->idle;
+		if (arena) {
+			registry->idle = arena->m_next_idle;
+			locker.unlock();
+
+			// The counters describe the thread or dispatcher the arena works for; the blocks in use are still there
+			QMutexLocker arena_locker(&arena->m_lock);
+			arena->m_next_idle   = 0;
+			arena->m_allocations = 0;
+			arena->m_frees       = 0;
+			return arena;
+		}
+	}
+
+	return new MemoryArena();
+}
+
+/**
+ * @return Size class for a block of @a size bytes; -1 if the block is too large for the arena
+ */
+int MemoryArena::sizeClass(size_t size)
+{
+	if (size > MemoryArena::MaxSmall) {
+		return -1;
+	}
+
+	int idx = 0;
+	while (size_classes[idx] < size) {
+		++idx;
+	}
+
+	return idx;
+}
+
+/**
+ * @brief Cuts @a size bytes off the current chunk, starting a new chunk if needed
+ * @note Called with m_lock held
+ */
+void* MemoryArena::carve(size_t size)
+{
+	if (this->m_chunk_left < size) {
+		// The tail of the old chunk is lost; it is shorter than the largest class
+		this->m_chunk = static_cast<char*>(::malloc(MemoryArena::ChunkSize));
+		if (!this->m_chunk) {
+			this->m_chunk_left = 0;
+			return 0;
+		}
+
+		this->m_chunk_left = MemoryArena::ChunkSize;
+	}
+
+	void* p             = this->m_chunk;
+	this->m_chunk      += size;
+	this->m_chunk_left -= size;
+	return p;
+}
+
+void* MemoryArena::allocate(size_t size)
+{
+	int cls = MemoryArena::sizeClass(size);
+	BlockHeader* header;
+
+	QMutexLocker locker(&this->m_lock);
+	if (cls >= 0) {
+		FreeBlock* block = this->m_free[cls];
+		if (block) {
+			this->m_free[cls] = block->node.next;
+			header            = &block->header;
+		}
+		else {
+			header = static_cast<BlockHeader*>(this->carve(sizeof(BlockHeader) + size_classes[cls]));
+		}
+	}
+	else {
+		header = static_cast<BlockHeader*>(::malloc(sizeof(BlockHeader) + size));
+	}
+
+	if (Q_UNLIKELY(!header)) {
+		return 0;
+	}
+
+	header->h.arena      = this;
+	header->h.size_class = cls;
+	header->h.size       = static_cast<quint32>(size);
+
+	++this->m_allocations;
+	this->m_bytes += size;
+	return header + 1;
+}
+
+void MemoryArena::release(BlockHeader* header)
+{
+	QMutexLocker locker(&this->m_lock);
+	++this->m_frees;
+	this->m_bytes -= header->h.size;
+
+	int cls = header->h.size_class;
+	if (cls >= 0) {
+		FreeBlock* block  = reinterpret_cast<FreeBlock*>(header);
+		block->node.next  = this->m_free[cls];
+		this->m_free[cls] = block;
+	}
+	else {
+		::free(header);
+	}
+}
+
+void* MemoryArena::malloc_fn(size_t size)
+{
+	MemoryArena* arena = MemoryArena::current();
+	if (Q_LIKELY(arena != 0)) {
+		return arena->allocate(size);
+	}
+
+	// The thread storage is gone (the process is exiting): fall back to the system allocator
+	BlockHeader* header = static_cast<BlockHeader*>(::malloc(sizeof(BlockHeader) + size));
+	if (!header) {
+		return 0;
+	}
+
+	header->h.arena      = 0;
+	header->h.size_class = -1;
+	header->h.size       = static_cast<quint32>(size);
+	return header + 1;
+}
+
+void* MemoryArena::realloc_fn(void* ptr, size_t size)
+{
+	if (!ptr) {
+		return MemoryArena::malloc_fn(size);
+	}
+
+	BlockHeader* header = static_cast<BlockHeader*>(ptr) - 1;
+	int cls             = header->h.size_class;
+	if (cls >= 0 && size <= size_classes[cls] && header->h.arena) {
+		// Still fits into the block
+		MemoryArena* arena = header->h.arena;
+		QMutexLocker locker(&arena->m_lock);
+		arena->m_bytes   += size;
+		arena->m_bytes   -= header->h.size;
+		header->h.size    = static_cast<quint32>(size);
+		return ptr;
+	}
+
+	if (cls < 0) {
+		// Blocks of the system allocator stay there: let it grow or shrink the block in place if it can
+		MemoryArena* arena = header->h.arena;
+		quint32 old_size   = header->h.size;
+		header             = static_cast<BlockHeader*>(::realloc(header, sizeof(BlockHeader) + size));
+		if (!header) {
+			return 0;
+		}
+
+		header->h.size = static_cast<quint32>(size);
+		if (arena) {
+			QMutexLocker locker(&arena->m_lock);
+			arena->m_bytes += size;
+			arena->m_bytes -= old_size;
+		}
+
+		return header + 1;
+	}
+
+	void* p = MemoryArena::malloc_fn(size);
+	if (p) {
+		memcpy(p, ptr, qMin(size, size_t(header->h.size)));
+		MemoryArena::free_fn(ptr);
+	}
+
+	return p;
+}
+
+void MemoryArena::free_fn(void* ptr)
+{
+	if (!ptr) {
+		return;
+	}
+
+	BlockHeader* header = static_cast<BlockHeader*>(ptr) - 1;
+	if (header->h.arena) {
+		header->h.arena->release(header);
+	}
+	else {
+		::free(header);
+	}
+}
@@ -0,0 +1,82 @@
+#ifndef ARENA_P_H
+#define ARENA_P_H
+
+#include <QtCore/QtGlobal>
+#include <QtCore/QMutex>
+#include "qt4compat.h"
+
+/**
+ * @internal
+ * @brief Per-thread memory arena for libevent's internal allocations
+ *
+ * Once installed with @c event_set_mem_functions(), every allocation libevent makes
+ * (event bases, @c event_new(), evmap entries, changelists, backend result arrays)
+ * comes from the arena of the calling thread instead of the global heap.
+ *
+ * Small blocks are served from size classes tuned for <tt>struct event</tt> and the evmap
+ * records; they are carved out of chunks and recycled through per-class free lists.
+ * Larger blocks go to the system allocator but are accounted to the arena as well.
+ * Every block carries a header with its arena, so a block freed by another thread goes
+ * back where it came from; the per-arena lock is thus almost never contended.
+ *
+ * A dispatcher has an arena of its own, acquire()d when it is created and bound to the thread
+ * which runs it, so that its counters describe the dispatcher even if it has been created by
+ * another thread. Threads without a dispatcher get an arena on their first allocation.
+ *
+ * Arenas live for the lifetime of the process: when a thread exits or a dispatcher is destroyed,
+ * its arena (together with the blocks still in use) is handed over to the next one which needs it.
+ */
+class Q_DECL_HIDDEN MemoryArena {
+public:
+	static bool install(void);
+	static bool isInstalled(void);
+	static void freeze(void);
+	static MemoryArena* current(void);
+	static MemoryArena* acquire(void);
+	static void retire(MemoryArena* arena);
+	static MemoryArena* bind(MemoryArena* arena);
+	static void unbind(MemoryArena* arena);
+
+	quint64 allocations(void) const { return this->m_allocations; }
+	quint64 frees(void) const { return this->m_frees; }
+	quint64 bytes(void) const { return this->m_bytes; }
+
+	struct Holder;
+
+	enum {
+		ClassCount = 12,
+		ChunkSize  = 65536,
+		MaxSmall   = 1024
+	};
+
+private:
+	Q_DISABLE_COPY(MemoryArena)
+
+	union FreeBlock;
+	union BlockHeader;
+	friend struct Holder;
+
+	MemoryArena(void);
+
+	QMutex m_lock;
+	FreeBlock* m_free[ClassCount];
+	char* m_chunk;             ///< Unused part of the current chunk
+	size_t m_chunk_left;
+	quint64 m_allocations;     ///< Updated under m_lock; read without it by the statistics
+	quint64 m_frees;
+	quint64 m_bytes;           ///< Requested sizes of the blocks in use
+	MemoryArena* m_next_idle;  ///< Next arena without a thread
+
+	void* allocate(size_t size);
+	void release(BlockHeader* header);
+	void* carve(size_t size);
+
+	static int sizeClass(size_t size);
+	static MemoryArena::Holder* holder(void);
+
+	static void* malloc_fn(size_t size);
+	static void* realloc_fn(void* ptr, size_t size);
+	static void free_fn(void* ptr);
+};
+
+#endif // ARENA_P_H
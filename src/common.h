@@ -35,6 +35,7 @@
 #	include "libevent2-emul.h"
 #else
 #	include <event2/event.h>
+#	include <event2/event_struct.h>
 #endif
 
 #endif // INCLUDEWIN_H
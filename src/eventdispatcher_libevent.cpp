@@ -50,7 +50,7 @@ EventDispatcherLibEvent::EventDispatcherLibEvent(QObject* parent)
  * @see EventDispatcherLibEventConfig
  */
 EventDispatcherLibEvent::EventDispatcherLibEvent(const EventDispatcherLibEventConfig& config, QObject* parent)
-	: QAbstractEventDispatcher(parent), d_ptr(new EventDispatcherLibEventPrivate(this, config))
+	: QAbstractEventDispatcher(parent), d_ptr(new EventDispatcherLibEventPrivate(this, &config))
 {
 }
 
@@ -184,6 +184,89 @@ void EventDispatcherLibEvent::unregisterSocketNotifier(QSocketNotifier* notifier
 	d->unregisterSocketNotifier(notifier);
 }
 
+/**
+ * Switches the descriptor of @a notifier between edge-triggered and level-triggered modes
+ *
+ * @param notifier Socket notifier
+ * @param enable Whether the notifier should be edge-triggered
+ * @return Whether the mode has been changed
+ * @retval false If the backend does not support edge-triggered events
+ * @note The mode is a property of the descriptor: it applies to both read and write notifiers
+ * of @a notifier's socket and survives notifier toggles. Once the descriptor is reused by another
+ * socket, its first new notifier brings back the mode of EventDispatcherLibEventConfig::setEdgeTriggered()
+ * @warning The code handling activations of an edge-triggered notifier must read (or write)
+ * until the operation fails with @c EAGAIN, otherwise the notifier will not be activated again
+ * until it is disabled and enabled back
+ * @see EventDispatcherLibEventConfig::setEdgeTriggered()
+ */
+bool EventDispatcherLibEvent::setEdgeTriggered(QSocketNotifier* notifier, bool enable)
+{
+	if (notifier->type() == QSocketNotifier::Exception) {
+		return false;
+	}
+
+	Q_D(EventDispatcherLibEvent);
+	return d->setEdgeTriggered(notifier->socket(), enable);
+}
+
+/**
+ * Assigns the priority class @a priority to the descriptor of @a notifier
+ *
+ * @param notifier Socket notifier
+ * @param priority Priority class
+ * @return Whether the priority class has been assigned
+ * @note Like the edge-triggered mode, the priority class is a property of the descriptor:
+ * it applies to both read and write notifiers of @a notifier's socket and survives notifier toggles
+ *
+ * The activations collected by one iteration of the event loop are delivered class by class,
+ * starting with @c HighPriority; within a class they are delivered in the order they arrived.
+ * When the iteration has a dispatch budget, what is left over belongs to the lower classes.
+ *
+ * @see EventDispatcherLibEventConfig::setDispatchBudget()
+ */
+bool EventDispatcherLibEvent::setPriority(QSocketNotifier* notifier, Priority priority)
+{
+	if (notifier->type() == QSocketNotifier::Exception) {
+		return false;
+	}
+
+	Q_D(EventDispatcherLibEvent);
+	return d->setSocketPriority(notifier->socket(), priority);
+}
+
+/**
+ * Assigns the priority class @a priority to the timer @a timerId
+ *
+ * @param timerId Timer ID
+ * @param priority Priority class
+ * @return Whether the timer is registered with this dispatcher
+ * @see setPriority()
+ */
+bool EventDispatcherLibEvent::setTimerPriority(int timerId, Priority priority)
+{
+	Q_D(EventDispatcherLibEvent);
+	return d->setTimerPriority(timerId, priority);
+}
+
+/**
+ * Assigns the priority class @a priority to the timers and socket notifiers of @a object and its children
+ *
+ * @param object Object
+ * @param priority Priority class
+ * @note Timers and socket notifiers created later get @c NormalPriority
+ * @see setPriority()
+ */
+void EventDispatcherLibEvent::setObjectPriority(QObject* object, Priority priority)
+{
+	if (!object) {
+		qWarning("%s: invalid arguments", Q_FUNC_INFO);
+		return;
+	}
+
+	Q_D(EventDispatcherLibEvent);
+	d->setObjectPriority(object, priority);
+}
+
 /**
  * Register a timer with the specified @a timerId, @a interval, and @a timerType
  * for the given @a object.
@@ -352,6 +435,222 @@ void EventDispatcherLibEvent::flush(void)
 {
 }
 
+/**
+ * Queues a call of @a func with the argument @a context in the dispatcher's thread. Thread-safe
+ *
+ * @param func Function to call
+ * @param context Argument for @a func
+ * @return Whether the task has been queued
+ * @note Unlike QCoreApplication::postEvent(), posting a task neither allocates memory in the steady
+ * state nor takes the locks of the event queue: the task node comes from the dispatcher's free list,
+ * the task is pushed onto a lock-free queue, and the dispatcher is signalled only if it may be
+ * waiting for events
+ * @note Tasks are run in the order they have been posted, after the posted events
+ * @warning Tasks which are still queued when the dispatcher is destroyed are not run
+ */
+bool EventDispatcherLibEvent::postTask(TaskFunction func, void* context)
+{
+	return this->postTask(func, context, 0);
+}
+
+/**
+ * @fn bool EventDispatcherLibEvent::postTask(Functor f)
+ *
+ * Queues a call of @a f in the dispatcher's thread. Thread-safe
+ *
+ * A copy of @a f is destroyed in the dispatcher's thread after it has been called
+ * (or when the dispatcher is destroyed, if the task has not been run).
+ * This overload is available only if the compiler supports lambdas.
+ *
+ * @see postTask(TaskFunction, void*)
+ */
+
+bool EventDispatcherLibEvent::postTask(TaskFunction func, void* context, TaskFunction dispose)
+{
+	Q_D(EventDispatcherLibEvent);
+	return d->postTask(func, context, dispose);
+}
+
+/**
+ * Queues a call of @a func with the argument @a context which any dispatcher of the work stealing group may run. Thread-safe
+ *
+ * @param func Function to call
+ * @param context Argument for @a func
+ * @return Whether the task has been queued
+ *
+ * Stealable tasks are meant for CPU-bound work which is not tied to the objects of a particular thread.
+ * The dispatcher runs one stealable task per event loop iteration, so that its I/O is not starved;
+ * a dispatcher which is about to block takes a task from its peers instead. If the dispatcher
+ * has a backlog of stealable tasks, posting one more wakes up an idle peer.
+ *
+ * If the dispatcher does not belong to a work stealing group, this is the same as postTask().
+ *
+ * @warning @a func may be called in any thread of the group
+ * @see enableWorkStealing()
+ */
+bool EventDispatcherLibEvent::postStealableTask(TaskFunction func, void* context)
+{
+	return this->postStealableTask(func, context, 0);
+}
+
+bool EventDispatcherLibEvent::postStealableTask(TaskFunction func, void* context, TaskFunction dispose)
+{
+	Q_D(EventDispatcherLibEvent);
+	return d->postStealableTask(func, context, dispose);
+}
+
+/**
+ * Makes @a dispatchers steal stealable tasks from each other
+ *
+ * @param dispatchers Dispatchers to group
+ * @warning Must be called before any of @a dispatchers starts processing events
+ * @see postStealableTask()
+ */
+void EventDispatcherLibEvent::enableWorkStealing(const QList<EventDispatcherLibEvent*>& dispatchers)
+{
+	EventDispatcherLibEventPrivate::enableWorkStealing(dispatchers);
+}
+
+/**
+ * Moves @a objects, together with their socket notifiers and timers, to the thread of @a target. Thread-safe
+ *
+ * @param objects Objects to move; they must live in this dispatcher's thread and must not have parents
+ * @param target Event dispatcher to move the objects to
+ * @param done Function called in @a target's thread when the migration is complete; may be 0
+ * @param context Argument for @a done
+ * @return Whether the migration has been started
+ *
+ * The migration is a two-phase handshake over the dispatchers' task queues. First, this dispatcher's thread
+ * moves all @a objects at once, so that no activation is delivered to a half-moved set. Then @a target's
+ * thread registers the notifiers, restores the edge-triggered mode and the priority class of their descriptors and calls @a done.
+ * Readiness which arrives in between is reported by @a target's backend when the notifiers are registered.
+ *
+ * @note Objects destroyed before their turn are skipped. So are the objects which cannot be moved
+ * (e.g. because they have a parent): they are reported with a warning and stay in this dispatcher's thread
+ * @see EventDispatcherLibEventPool
+ */
+bool EventDispatcherLibEvent::migrate(const QList<QObject*>& objects, EventDispatcherLibEvent* target, TaskFunction done, void* context)
+{
+	if (!target) {
+		qWarning("%s: invalid arguments", Q_FUNC_INFO);
+		return false;
+	}
+
+	Q_D(EventDispatcherLibEvent);
+	return d->migrate(objects, target, done, context);
+}
+
+/**
+ * Takes a snapshot of the performance counters of the dispatcher
+ *
+ * @return Counters accumulated since the dispatcher was created or since the last resetStatistics()
+ *
+ * The counters are plain integers updated by the dispatcher's thread without any synchronization,
+ * so that they can stay enabled in production. Even the wake-up counters are kept by the dispatcher:
+ * it counts the signals it consumes, so that the posting threads do not contend on a shared counter.
+ *
+ * @note Time spent in a nested event loop is counted by both the nested and the outer iteration
+ * @warning Call from the dispatcher's thread; from another thread, take the snapshot in a task (see postTask())
+ * @see EventDispatcherLibEventStatistics
+ */
+EventDispatcherLibEventStatistics EventDispatcherLibEvent::statistics(void) const
+{
+	const Q_D(EventDispatcherLibEvent);
+	EventDispatcherLibEventStatistics stats;
+	d->statistics(stats);
+	return stats;
+}
+
+/**
+ * Resets the performance counters; the numbers of registered timers and socket notifiers are kept
+ *
+ * @warning Call from the dispatcher's thread
+ */
+void EventDispatcherLibEvent::resetStatistics(void)
+{
+	Q_D(EventDispatcherLibEvent);
+	d->resetStatistics();
+}
+
+/**
+ * Replaces the clock the timers are measured with
+ *
+ * @param func Clock returning the current time in microseconds; 0 restores the system monotonic clock
+ * @param context Argument passed to @a func
+ *
+ * The clock must not go backwards. With a custom clock all timers, precise ones included, are kept
+ * in the timer wheel with millisecond resolution; the dispatcher still sleeps on the system clock,
+ * for as long as the custom clock says the nearest timer is away, but every iteration of the event loop
+ * also checks the clock, so that a clock which jumps forward delivers the expired timers
+ * on the next call to processEvents().
+ *
+ * The registered timers start over from the current time of the new clock.
+ *
+ * @warning Call from the dispatcher's thread
+ * @see setVirtualClock()
+ */
+void EventDispatcherLibEvent::setClock(EventDispatcherLibEvent::ClockFunction func, void* context)
+{
+	Q_D(EventDispatcherLibEvent);
+	d->setClock(func, context);
+}
+
+/**
+ * Switches the timers to a virtual clock which moves only when advanceClock() is called
+ *
+ * @param start Initial time of the virtual clock (usec)
+ *
+ * This is meant for simulations: the coalescing of coarse timers and the resets of drifted timers work
+ * exactly as with the system clock, but nothing waits in real time, so hours of timer traffic can be
+ * replayed in seconds. processEvents() delivers only the timers which are due at the current virtual time;
+ * the others fire when advanceClock() reaches them. This includes zero-interval timers: like all timers under
+ * a custom clock, they live in the timer wheel with millisecond resolution, so they fire once per virtual
+ * millisecond, and only when advanceClock() moves the clock.
+ *
+ * @warning Call from the dispatcher's thread
+ * @see advanceClock(), setClock()
+ */
+void EventDispatcherLibEvent::setVirtualClock(qint64 start)
+{
+	Q_D(EventDispatcherLibEvent);
+	d->setVirtualClock(start);
+}
+
+/**
+ * @return Current time of the clock the timers are measured with (usec); the epoch is unspecified
+ * @see setClock(), setVirtualClock()
+ */
+qint64 EventDispatcherLibEvent::clockTime(void) const
+{
+	const Q_D(EventDispatcherLibEvent);
+	return d->clockTime();
+}
+
+/**
+ * Moves the virtual clock forward and delivers the timers which expire on the way, in order, without sleeping
+ *
+ * @param usec Time step (usec)
+ * @return Number of delivered events
+ * @retval -1 The dispatcher does not use the virtual clock, or @a usec is negative
+ *
+ * The clock stops at the expiration time of every timer: a timer rescheduled by the handler
+ * fires again within the same step if its next expiration time is not past the end of the step.
+ * Posted events are not sent and socket notifiers are not polled: call processEvents() for them.
+ *
+ * @warning Call from the dispatcher's thread
+ * @see setVirtualClock()
+ */
+int EventDispatcherLibEvent::advanceClock(qint64 usec)
+{
+	Q_D(EventDispatcherLibEvent);
+	if (usec < 0 || !d->isVirtualClock()) {
+		qWarning("%s: invalid arguments", Q_FUNC_INFO);
+		return -1;
+	}
+
+	return d->advanceClock(usec);
+}
+
 /**
  * @brief EventDispatcherLibEvent::EventDispatcherLibEvent
  * @param dd
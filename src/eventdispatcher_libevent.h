@@ -2,6 +2,7 @@
 #define EVENTDISPATCHER_LIBEVENT_H
 
 #include <QtCore/QAbstractEventDispatcher>
+#include "eventdispatcher_libevent_stats.h"
 
 class EventDispatcherLibEventPrivate;
 class EventDispatcherLibEventConfig;
@@ -20,6 +21,17 @@ public:
 
 	virtual void registerSocketNotifier(QSocketNotifier* notifier);
 	virtual void unregisterSocketNotifier(QSocketNotifier* notifier);
+	bool setEdgeTriggered(QSocketNotifier* notifier, bool enable);
+
+	enum Priority {
+		HighPriority,
+		NormalPriority,
+		LowPriority
+	};
+
+	bool setPriority(QSocketNotifier* notifier, Priority priority);
+	bool setTimerPriority(int timerId, Priority priority);
+	void setObjectPriority(QObject* object, Priority priority);
 
 	virtual void registerTimer(
 		int timerId,
@@ -46,6 +58,38 @@ public:
 	virtual void interrupt(void);
 	virtual void flush(void);
 
+	typedef void (*TaskFunction)(void* context);
+	bool postTask(TaskFunction func, void* context);
+#ifdef Q_COMPILER_LAMBDA
+	template<typename Functor>
+	bool postTask(Functor f)
+	{
+		return this->postTask(&EventDispatcherLibEvent::callFunctor<Functor>, new Functor(f), &EventDispatcherLibEvent::deleteFunctor<Functor>);
+	}
+#endif
+
+	bool postStealableTask(TaskFunction func, void* context);
+#ifdef Q_COMPILER_LAMBDA
+	template<typename Functor>
+	bool postStealableTask(Functor f)
+	{
+		return this->postStealableTask(&EventDispatcherLibEvent::callFunctor<Functor>, new Functor(f), &EventDispatcherLibEvent::deleteFunctor<Functor>);
+	}
+#endif
+
+	static void enableWorkStealing(const QList<EventDispatcherLibEvent*>& dispatchers);
+
+	bool migrate(const QList<QObject*>& objects, EventDispatcherLibEvent* target, TaskFunction done = 0, void* context = 0);
+
+	EventDispatcherLibEventStatistics statistics(void) const;
+	void resetStatistics(void);
+
+	typedef qint64 (*ClockFunction)(void* context);
+	void setClock(ClockFunction func, void* context = 0);
+	void setVirtualClock(qint64 start = 0);
+	qint64 clockTime(void) const;
+	int advanceClock(qint64 usec);
+
 protected:
 	EventDispatcherLibEvent(EventDispatcherLibEventPrivate& dd, QObject* parent = 0);
 
@@ -60,6 +104,25 @@ private:
 #else
 	EventDispatcherLibEventPrivate* d_ptr;
 #endif
+
+	bool postTask(TaskFunction func, void* context, TaskFunction dispose);
+	bool postStealableTask(TaskFunction func, void* context, TaskFunction dispose);
+
+#ifdef Q_COMPILER_LAMBDA
+	template<typename Functor>
+	static void callFunctor(void* context)
+	{
+		Functor* f = static_cast<Functor*>(context);
+		(*f)();
+		delete f;
+	}
+
+	template<typename Functor>
+	static void deleteFunctor(void* context)
+	{
+		delete static_cast<Functor*>(context);
+	}
+#endif
 };
 
 #endif // EVENTDISPATCHER_LIBEVENT_H
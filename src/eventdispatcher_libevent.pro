@@ -9,22 +9,40 @@ HEADERS += \
 	eventdispatcher_libevent_p.h \
 	eventdispatcher_libevent_config.h \
 	eventdispatcher_libevent_config_p.h \
+	eventdispatcher_libevent_stats.h \
 	libevent2-emul.h \
 	qt4compat.h \
 	tco.h \
 	tco_impl.h \
+	slab_p.h \
+	eventqueue_p.h \
+	taskqueue_p.h \
+	timerwheel_p.h \
+	trace_p.h \
+	arena_p.h \
 	common.h
 
 SOURCES += \
 	eventdispatcher_libevent.cpp \
 	eventdispatcher_libevent_p.cpp \
 	timers_p.cpp \
+	timerwheel_p.cpp \
 	socknot_p.cpp \
+	tasks_p.cpp \
+	migration_p.cpp \
+	arena_p.cpp \
 	eventdispatcher_libevent_config.cpp
 
 PRECOMPILED_HEADER = common.h
 
-headers.files = eventdispatcher_libevent.h eventdispatcher_libevent_config.h
+headers.files = eventdispatcher_libevent.h eventdispatcher_libevent_config.h eventdispatcher_libevent_stats.h
+
+# Custom event dispatchers for threads require QThread::setEventDispatcher()
+greaterThan(QT_MAJOR_VERSION, 4) {
+	HEADERS       += eventdispatcher_libevent_pool.h eventdispatcher_libevent_pool_p.h
+	SOURCES       += eventdispatcher_libevent_pool.cpp
+	headers.files += eventdispatcher_libevent_pool.h
+}
 
 unix {
 	CONFIG += create_pc
@@ -55,6 +73,9 @@ unix {
 		LIBS += -levent_core
 	}
 
+	# clock_gettime() lives in librt in older glibc versions
+	linux*: LIBS += -lrt
+
 	target.path  = /usr/lib
 	headers.path = /usr/include
 
@@ -1,5 +1,6 @@
 #include "common.h"
 #include "eventdispatcher_libevent_config.h"
+#include "arena_p.h"
 
 #ifndef SJ_LIBEVENT_EMULATION
 #	include "eventdispatcher_libevent_config_p.h"
@@ -20,10 +21,36 @@ EventDispatcherLibEventConfig::~EventDispatcherLibEventConfig(void)
 #endif
 }
 
+/**
+ * Makes libevent take its memory from per-dispatcher arenas instead of the global heap
+ *
+ * @return Whether the allocator has been installed
+ * @retval false libevent is 1.x, was built without memory allocation replacement, or has already been used
+ *
+ * libevent allocates its internal structures (event bases, events from @c event_new(), the maps of descriptors,
+ * the change lists and the result arrays of the backends) with the process-wide @c malloc(), which becomes
+ * a point of contention when many threads run their own dispatchers. With the arena allocator, every thread
+ * allocates from its own pools of size classes tuned for <tt>struct event</tt> and the descriptor map records;
+ * blocks freed by another thread return to the arena they came from. Each dispatcher has an arena of its own,
+ * which takes its event base (wherever the dispatcher is created) and the allocations of the thread running it;
+ * the memory used by each dispatcher shows up in EventDispatcherLibEventStatistics.
+ *
+ * @warning The allocator is process-wide and cannot be changed once libevent has allocated anything:
+ * call this function at the very beginning of @c main(), before any EventDispatcherLibEvent or
+ * EventDispatcherLibEventConfig is created and before anything else in the process uses libevent.
+ */
+bool EventDispatcherLibEventConfig::installArenaAllocator(void)
+{
+	return MemoryArena::install();
+}
+
 #ifdef SJ_LIBEVENT_EMULATION
 bool EventDispatcherLibEventConfig::avoidMethod(const QLatin1String&) { return false; }
 bool EventDispatcherLibEventConfig::requireFeatures(Features) { return false; }
 bool EventDispatcherLibEventConfig::setConfiguration(Configuration) { return false; }
+bool EventDispatcherLibEventConfig::setEdgeTriggered(bool) { return false; }
+bool EventDispatcherLibEventConfig::setBusyPoll(int) { return false; }
+bool EventDispatcherLibEventConfig::setDispatchBudget(int, int) { return false; }
 #else
 bool EventDispatcherLibEventConfig::avoidMethod(const QLatin1String& method)
 {
@@ -79,10 +106,76 @@ bool EventDispatcherLibEventConfig::setConfiguration(Configuration cfg)
 	return d->setConfiguration(config);
 }
 
+/**
+ * @brief Makes socket notifiers edge-triggered (@c EV_ET)
+ * @param enable Whether to register socket notifiers as edge-triggered
+ * @return Always @c true
+ *
+ * An edge-triggered notifier is activated only when the state of its descriptor changes:
+ * the code handling the activation must read (or write) until the operation fails with @c EAGAIN,
+ * or disable the notifier and enable it later (enabling the notifier re-arms it).
+ * Read and write notifiers of the same descriptor are either both edge-triggered or both level-triggered.
+ *
+ * If the backend does not support edge-triggered events, the option is ignored.
+ *
+ * @see EventDispatcherLibEvent::setEdgeTriggered()
+ */
+bool EventDispatcherLibEventConfig::setEdgeTriggered(bool enable)
+{
+	Q_D(EventDispatcherLibEventConfig);
+	return d->setEdgeTriggered(enable);
+}
+
+/**
+ * @brief Makes the dispatcher spin for up to @a usec microseconds before it blocks waiting for events
+ * @param usec Maximum duration of the spin phase (microseconds); 0 disables busy polling
+ * @return Whether the value has been accepted
+ * @retval false If @a usec is negative
+ *
+ * Instead of going to sleep right away, the dispatcher polls for events without blocking
+ * and watches for posted events until something arrives or the spin budget is exhausted.
+ * This saves the sleep/wake-up round trip at the expense of CPU time.
+ *
+ * The actual budget starts at 10 microseconds (or @a usec, if smaller) and adapts to the workload:
+ * the dispatcher counts the spin phases which found work and the ones which ended in a sleep. The budget grows when most sleeps are shorter than @a usec
+ * and shrinks when less than a quarter of the spin phases pay off.
+ */
+bool EventDispatcherLibEventConfig::setBusyPoll(int usec)
+{
+	Q_D(EventDispatcherLibEventConfig);
+	return d->setBusyPoll(usec);
+}
+
+/**
+ * @brief Limits the work done by one iteration of the event loop
+ * @param usec Time budget for delivering socket and timer events (microseconds); 0 means no limit
+ * @param max_events Maximum number of socket and timer events delivered per iteration; 0 means no limit
+ * @return Whether the values have been accepted
+ * @retval false If @a usec or @a max_events is negative
+ *
+ * Without a budget, one iteration delivers everything that became ready, so a flood of ready sockets
+ * delays timers and other sockets until all of them have been handled. With a budget, the iteration
+ * stops when the budget is used up (at least one event is always delivered); the rest is delivered
+ * first by the next iteration, which polls the backend without blocking, so that due timers
+ * and newly ready descriptors are picked up in between.
+ *
+ * No more than @a max_events socket activations are collected from the backend per iteration;
+ * the other ready descriptors are collected later. With libevent 2.1 the limits are also passed
+ * to @c event_config_set_max_dispatch_interval(), which makes libevent check for due timers
+ * while it runs the callbacks.
+ *
+ * @note Posted events are delivered by @c QCoreApplication::sendPostedEvents() and are not subject to the budget
+ */
+bool EventDispatcherLibEventConfig::setDispatchBudget(int usec, int max_events)
+{
+	Q_D(EventDispatcherLibEventConfig);
+	return d->setDispatchBudget(usec, max_events);
+}
 
 EventDispatcherLibEventConfigPrivate::EventDispatcherLibEventConfigPrivate(void)
-	: m_cfg(0)
+	: m_cfg(0), m_edge_triggered(false), m_busy_poll(0), m_dispatch_usec(0), m_dispatch_max(0)
 {
+	MemoryArena::freeze();
 	this->m_cfg = event_config_new();
 	Q_CHECK_PTR(this->m_cfg);
 }
@@ -110,4 +203,40 @@ bool EventDispatcherLibEventConfigPrivate::setConfiguration(int config)
 	return 0 == event_config_set_flag(this->m_cfg, config);
 }
 
+bool EventDispatcherLibEventConfigPrivate::setEdgeTriggered(bool enable)
+{
+	this->m_edge_triggered = enable;
+	return true;
+}
+
+bool EventDispatcherLibEventConfigPrivate::setBusyPoll(int usec)
+{
+	if (usec < 0) {
+		return false;
+	}
+
+	this->m_busy_poll = usec;
+	return true;
+}
+
+bool EventDispatcherLibEventConfigPrivate::setDispatchBudget(int usec, int max_events)
+{
+	if (usec < 0 || max_events < 0) {
+		return false;
+	}
+
+#if defined(LIBEVENT_VERSION_NUMBER) && LIBEVENT_VERSION_NUMBER >= 0x02010100
+	struct timeval tv;
+	tv.tv_sec  = usec / 1000000;
+	tv.tv_usec = usec % 1000000;
+	if (0 != event_config_set_max_dispatch_interval(this->m_cfg, usec ? &tv : 0, max_events ? max_events : -1, 0)) {
+		return false;
+	}
+#endif
+
+	this->m_dispatch_usec = usec;
+	this->m_dispatch_max  = max_events;
+	return true;
+}
+
 #endif
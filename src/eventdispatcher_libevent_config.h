@@ -36,6 +36,11 @@ public:
 	bool avoidMethod(const QLatin1String& method);
 	bool requireFeatures(Features f);
 	bool setConfiguration(Configuration cfg);
+	bool setEdgeTriggered(bool enable);
+	bool setBusyPoll(int usec);
+	bool setDispatchBudget(int usec, int max_events);
+
+	static bool installArenaAllocator(void);
 
 private:
 	Q_DECLARE_PRIVATE(EventDispatcherLibEventConfig)
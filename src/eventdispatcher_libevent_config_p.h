@@ -13,8 +13,15 @@ public:
 	bool avoidMethod(const char* method);
 	bool requireFeatures(int features);
 	bool setConfiguration(int config);
+	bool setEdgeTriggered(bool enable);
+	bool setBusyPoll(int usec);
+	bool setDispatchBudget(int usec, int max_events);
 private:
 	event_config* m_cfg;
+	bool m_edge_triggered;
+	int m_busy_poll;
+	int m_dispatch_usec;
+	int m_dispatch_max;
 
 	friend class EventDispatcherLibEventPrivate;
 };
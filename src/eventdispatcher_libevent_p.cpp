@@ -3,6 +3,10 @@
 #include "eventdispatcher_libevent_p.h"
 #include "eventdispatcher_libevent_config.h"
 #include "eventdispatcher_libevent_config_p.h"
+#include "trace_p.h"
+#include "arena_p.h"
+
+SJ_DEFINE_TRACE_SEMAPHORES
 
 #ifdef Q_OS_WIN
 Q_GLOBAL_STATIC(WSAInitializer, wsa_initializer)
@@ -27,31 +31,30 @@ static void event_log_callback(int severity, const char* msg)
 /**
  * @brief Constructs the event dispatcher
  * @param q Pointer to event dispatcher's public interface
- */
-EventDispatcherLibEventPrivate::EventDispatcherLibEventPrivate(EventDispatcherLibEvent* const q)
-	: q_ptr(q), m_interrupt(false), m_base(0), m_wakeup(0), m_tco(0),
-	  m_notifiers(), m_timers(), m_event_list(), m_awaken(false)
-{
-	this->initialize(0);
-}
-
-/**
- * @brief Constructs the event dispatcher
- * @param q Pointer to event dispatcher's public interface
- * @param cfg Configuration
+ * @param cfg Configuration; 0 for the default configuration
  * @warning @a cfg parameter is ignored if the dispatcher is linked with libevent 1.x.
  * Configurations are supported since libevent 2.0
  */
-EventDispatcherLibEventPrivate::EventDispatcherLibEventPrivate(EventDispatcherLibEvent* const q, const EventDispatcherLibEventConfig& cfg)
-	: q_ptr(q), m_interrupt(false), m_base(0), m_wakeup(0), m_tco(0),
-	  m_notifiers(), m_timers(), m_event_list(), m_awaken(false)
+EventDispatcherLibEventPrivate::EventDispatcherLibEventPrivate(EventDispatcherLibEvent* const q, const EventDispatcherLibEventConfig* cfg)
+	: q_ptr(q), m_interrupt(false), m_base(0), m_wakeup(0), m_wheel_ev(0), m_tco(0),
+	  m_notifiers(), m_notifier_slab(), m_parked_notifiers(0), m_timers(), m_timer_slab(), m_object_timers(), m_wheel(), m_wheel_armed(-1),
+	  m_event_queues(), m_suppressed_notifiers(), m_suppressed_timers(),
+	  m_exclude_notifiers(false), m_edge_triggered(false), m_exclude_timers(false), m_awaken(false),
+	  m_task_queue(), m_task_nodes(), m_tasks(0), m_tasks_tail(&m_tasks),
+	  m_shared_lock(), m_shared_tasks(0), m_shared_tail(&m_shared_tasks), m_group(0),
+	  m_busy_poll_max(0), m_busy_poll(0), m_busy_poll_hits(0), m_busy_poll_misses(0), m_busy_poll_short(0),
+	  m_dispatch_usec(0), m_dispatch_max(0), m_stats(), m_arena(0), m_arena_bound(false),
+	  m_arena_allocations_base(0), m_arena_frees_base(0),
+	  m_clock(0), m_clock_context(0), m_virtual_time(0), m_now_valid(false), m_now(), m_loop_level(0)
 {
 #ifdef SJ_LIBEVENT_EMULATION
-	Q_UNUSED(cfg)
-	qWarning("LibEvent 1.x does not support custom configurations");
+	if (cfg) {
+		qWarning("LibEvent 1.x does not support custom configurations");
+	}
+
 	this->initialize(0);
 #else
-	this->initialize(&cfg);
+	this->initialize(cfg);
 #endif
 }
 
@@ -64,6 +67,7 @@ void EventDispatcherLibEventPrivate::initialize(const EventDispatcherLibEventCon
 	static bool init = false;
 	if (!init) {
 		init = true;
+		MemoryArena::freeze();
 
 #ifdef Q_OS_WIN
 		if (!WSAInitialized()) {
@@ -78,12 +82,25 @@ void EventDispatcherLibEventPrivate::initialize(const EventDispatcherLibEventCon
 #endif
 	}
 
+	// The event base is charged to the dispatcher even if another thread creates it (e.g. EventDispatcherLibEventPool)
+	MemoryArena* prev_arena = 0;
+	if (MemoryArena::isInstalled()) {
+		this->m_arena = MemoryArena::acquire();
+		prev_arena    = MemoryArena::bind(this->m_arena);
+	}
+
 #ifndef SJ_LIBEVENT_EMULATION
 	if (cfg) {
 		this->m_base = event_base_new_with_config(cfg->d_func()->m_cfg);
 		if (!this->m_base) {
 			qWarning("%s: Cannot create the event base with the specified configuration", Q_FUNC_INFO);
 		}
+
+		this->m_edge_triggered = cfg->d_func()->m_edge_triggered;
+		this->m_busy_poll_max  = cfg->d_func()->m_busy_poll;
+		this->m_busy_poll      = qMin(int(EventDispatcherLibEventPrivate::BusyPollMinBudget), this->m_busy_poll_max);
+		this->m_dispatch_usec  = cfg->d_func()->m_dispatch_usec;
+		this->m_dispatch_max   = cfg->d_func()->m_dispatch_max;
 	}
 #else
 	Q_UNUSED(cfg)
@@ -94,6 +111,21 @@ void EventDispatcherLibEventPrivate::initialize(const EventDispatcherLibEventCon
 		Q_CHECK_PTR(this->m_base);
 	}
 
+#ifndef SJ_LIBEVENT_EMULATION
+	if (this->m_edge_triggered && !(event_base_get_features(this->m_base) & EV_FEATURE_ET)) {
+		qWarning("%s: %s backend does not support edge-triggered events", Q_FUNC_INFO, event_base_get_method(this->m_base));
+		this->m_edge_triggered = false;
+	}
+#endif
+
+	if (-1 == event_base_priority_init(this->m_base, EventDispatcherLibEventPrivate::PriorityCount)) {
+		qWarning("%s: Cannot initialize event priorities", Q_FUNC_INFO);
+	}
+
+	// Reserved vectors are not shrunk by resize(0): suppressing activations does not allocate once the lists have grown
+	this->m_suppressed_notifiers.reserve(64);
+	this->m_suppressed_timers.reserve(64);
+
 	this->m_tco = new ThreadCommunicationObject();
 	if (!this->m_tco->valid()) {
 		qFatal("%s: failed to create a thread communication object", Q_FUNC_INFO);
@@ -101,7 +133,16 @@ void EventDispatcherLibEventPrivate::initialize(const EventDispatcherLibEventCon
 
 	this->m_wakeup = event_new(this->m_base, this->m_tco->fd(), EV_READ | EV_PERSIST, EventDispatcherLibEventPrivate::wake_up_handler, this);
 	Q_CHECK_PTR(this->m_wakeup);
+	event_priority_set(this->m_wakeup, 0);
 	event_add(this->m_wakeup, 0);
+
+	this->m_wheel_ev = event_new(this->m_base, -1, 0, EventDispatcherLibEventPrivate::wheel_callback, this);
+	Q_CHECK_PTR(this->m_wheel_ev);
+	event_priority_set(this->m_wheel_ev, 0);
+
+	if (this->m_arena) {
+		MemoryArena::bind(prev_arena);
+	}
 }
 
 /**
@@ -115,6 +156,18 @@ EventDispatcherLibEventPrivate::~EventDispatcherLibEventPrivate(void)
 		this->m_wakeup = 0;
 	}
 
+	if (this->m_wheel_ev) {
+		event_del(this->m_wheel_ev);
+		event_free(this->m_wheel_ev);
+		this->m_wheel_ev = 0;
+	}
+
+	this->leaveWorkStealingGroup();
+	this->discardTasks();
+	for (int i=0; i<EventDispatcherLibEventPrivate::PriorityCount; ++i) {
+		this->m_event_queues[i].clear();
+	}
+
 	this->killTimers();
 	this->killSocketNotifiers();
 
@@ -123,6 +176,12 @@ EventDispatcherLibEventPrivate::~EventDispatcherLibEventPrivate(void)
 		this->m_base = 0;
 	}
 
+	if (this->m_arena) {
+		MemoryArena::unbind(this->m_arena);
+		MemoryArena::retire(this->m_arena);
+		this->m_arena = 0;
+	}
+
 	delete this->m_tco;
 }
 
@@ -160,76 +219,404 @@ bool EventDispatcherLibEventPrivate::processEvents(QEventLoop::ProcessEventsFlag
 	const bool exclude_notifiers = (flags & QEventLoop::ExcludeSocketNotifiers);
 	const bool exclude_timers    = (flags & QEventLoop::X11ExcludeTimers);
 
-	exclude_notifiers && this->disableSocketNotifiers(true);
-	exclude_timers    && this->disableTimers(true);
+	SJ_TRACE2(process_events_enter, this, int(flags));
+
+	// From now on libevent's allocations in this thread are charged to the dispatcher
+	if (Q_UNLIKELY(this->m_arena && !this->m_arena_bound)) {
+		MemoryArena::bind(this->m_arena);
+		this->m_arena_bound = true;
+	}
+
+	++this->m_loop_level;
+	this->invalidateTime();
+
+	// Activations arriving while notifiers or timers are excluded are suppressed lazily
+	// by the callbacks; here we only bring back what was suppressed by the previous calls
+	const bool prev_exclude_notifiers = this->m_exclude_notifiers;
+	const bool prev_exclude_timers    = this->m_exclude_timers;
+	this->m_exclude_notifiers         = exclude_notifiers;
+	this->m_exclude_timers            = exclude_timers;
+
+	exclude_notifiers || this->resumeSocketNotifiers();
+	exclude_timers    || this->resumeTimers();
+
+	// From now on wakeUp() does not need to signal the descriptor: posted events are checked below.
+	// Wake-ups counted here came while the dispatcher was running and did not signal it either
+	this->m_stats.wakeUpsSuppressed += this->m_tco->markRunning();
 
 	this->m_interrupt = false;
 	this->m_awaken    = false;
 
 	bool result = q->hasPendingEvents();
 
+	++this->m_stats.iterations;
+
+	struct timeval t1;
+	struct timeval t2;
+	EventDispatcherLibEventPrivate::monotonicTime(t1);
+
 	Q_EMIT q->awake();
+	SJ_TRACE1(posted_events_enter, this);
 #if QT_VERSION < 0x040500
 	QCoreApplication::sendPostedEvents(0, (flags & QEventLoop::DeferredDeletion) ? -1 : 0);
 #else
 	QCoreApplication::sendPostedEvents();
 #endif
+	SJ_TRACE1(posted_events_exit, this);
+
+	EventDispatcherLibEventPrivate::monotonicTime(t2);
+	this->m_stats.postedEventsTime += EventDispatcherLibEventPrivate::elapsed(t1, t2);
+
+	result |= this->runTasks();
+
+	if (Q_UNLIKELY(this->m_clock != 0)) {
+		// A custom clock may jump ahead of the wheel event, which waits on the system clock
+		this->expireTimers();
+	}
+
+	// Events left over by the previous iteration are delivered without waiting for new ones
+	bool can_wait = !this->m_interrupt && (flags & QEventLoop::WaitForMoreEvents) && !result && !this->pendingEventCount();
+
+	// One stealable task per iteration, so that I/O is not starved; an idle dispatcher steals from its peers
+	if (this->m_group && this->runSharedTask(can_wait)) {
+		result   = true;
+		can_wait = false;
+	}
+
+	if (can_wait && this->m_busy_poll) {
+		can_wait = this->busyPoll();
+	}
 
-	const bool can_wait = !this->m_interrupt && (flags & QEventLoop::WaitForMoreEvents) && !result;
 	if (can_wait) {
 		Q_EMIT q->aboutToBlock();
+
+		// Fails if something has been posted (or the loop has been interrupted) since markRunning();
+		// otherwise whoever posts an event from now on signals the descriptor
+		if (!this->m_tco->markBlocking()) {
+			// Whatever has been posted is processed by this iteration, so the call is not idle
+			can_wait = false;
+			result   = true;
+		}
 	}
 
 	if (!this->m_interrupt) {
+		EventDispatcherLibEventPrivate::monotonicTime(t1);
+
+		if (can_wait) {
+			SJ_TRACE1(block_enter, this);
+		}
+
+		this->invalidateTime();
 		event_base_loop(this->m_base, EVLOOP_ONCE | (can_wait ? 0 : EVLOOP_NONBLOCK));
 
-#if QT_VERSION >= 0x040800
-		EventList list;
-		this->m_event_list.swap(list);
-#else
-		EventList list(this->m_event_list);
-		this->m_event_list.clear();
-#endif
+		if (can_wait) {
+			SJ_TRACE1(block_exit, this);
+		}
 
-		result |= (list.size() > 0) | this->m_awaken;
+		EventDispatcherLibEventPrivate::monotonicTime(t2);
+		qint64 polled = EventDispatcherLibEventPrivate::elapsed(t1, t2);
+		this->m_stats.pollTime += polled;
 
-		for (int i=0; i<list.size(); ++i) {
-			const PendingEvent& e = list.at(i);
-			if (!e.first.isNull()) {
-				QCoreApplication::sendEvent(e.first, e.second);
+		if (can_wait) {
+			++this->m_stats.blockingPolls;
+			this->m_stats.wakeUpsSuppressed += this->m_tco->markRunning();
+
+			if (this->m_busy_poll_max) {
+				this->adjustBusyPoll(false, polled);
 			}
 		}
+		else {
+			++this->m_stats.nonBlockingPolls;
+		}
 
-		struct timeval now;
-		struct timeval delta;
-		evutil_gettimeofday(&now, 0);
-
-		// Now that all event handlers have finished (and we returned from the recusrion), reactivate all pending timers
-		for (int i=0; i<list.size(); ++i) {
-			const PendingEvent& e = list.at(i);
-			if (!e.first.isNull() && e.second->type() == QEvent::Timer) {
-				QTimerEvent* te = static_cast<QTimerEvent*>(e.second);
-				TimerHash::Iterator tit = this->m_timers.find(te->timerId());
-				if (tit != this->m_timers.end()) {
-					TimerInfo* info = tit.value();
-
-					if (!event_pending(info->ev, EV_TIMEOUT, 0)) { // false in tst_QTimer::restartedTimerFiresTooSoon()
-						EventDispatcherLibEventPrivate::calculateNextTimeout(info, now, delta);
-						event_add(info->ev, &delta);
-					}
+		// Nested event loops started by the handlers deliver the rest of the activations
+		// collected here; in that case the head of the queue moves past its `end`
+		qint64 end[EventDispatcherLibEventPrivate::PriorityCount];
+		for (int i=0; i<EventDispatcherLibEventPrivate::PriorityCount; ++i) {
+			end[i] = this->m_event_queues[i].tail();
+		}
+
+		result |= (this->pendingEventCount() > 0) | this->m_awaken;
+
+		struct timeval deadline = t2;
+		if (this->m_dispatch_usec) {
+			struct timeval budget;
+			budget.tv_sec  = this->m_dispatch_usec / 1000000;
+			budget.tv_usec = this->m_dispatch_usec % 1000000;
+			evutil_timeradd(&deadline, &budget, &deadline);
+		}
+
+		// Higher priority classes first; the budget is shared by all of them
+		int delivered  = 0;
+		bool exhausted = false;
+		for (int i=0; i<EventDispatcherLibEventPrivate::PriorityCount && !exhausted; ++i) {
+			PendingEventQueue& queue = this->m_event_queues[i];
+			while (queue.head() < end[i]) {
+				if (delivered && this->isDispatchBudgetExhausted(delivered, deadline)) {
+					// The rest stays in the queues: the next iteration delivers it first and does not block
+					exhausted = true;
+					break;
 				}
-			}
 
-			delete e.second;
+				if (this->deliverEvent(queue.takeFirst())) {
+					++delivered;
+				}
+			}
 		}
+
+		EventDispatcherLibEventPrivate::monotonicTime(t1);
+		this->m_stats.dispatchTime += EventDispatcherLibEventPrivate::elapsed(t2, t1);
+		++this->m_stats.eventsPerIteration[EventDispatcherLibEventPrivate::histogramBucket(delivered)];
+
+		// Tasks taken by wake_up_handler() while we were waiting for events
+		this->runTasks();
 	}
 
-	exclude_notifiers && this->disableSocketNotifiers(false);
-	exclude_timers    && this->disableTimers(false);
+	this->m_exclude_notifiers = prev_exclude_notifiers;
+	this->m_exclude_timers    = prev_exclude_timers;
 
+	--this->m_loop_level;
+	this->invalidateTime();
+
+	SJ_TRACE2(process_events_exit, this, int(result));
 	return result;
 }
 
+/**
+ * @brief Assigns the priority class @a priority to the timers and the socket notifiers of @a object and its children
+ * @param object Object
+ * @param priority Priority class
+ */
+void EventDispatcherLibEventPrivate::setObjectPriority(QObject* object, int priority)
+{
+	QList<QObject*> objects = object->findChildren<QObject*>();
+	objects.prepend(object);
+
+	for (int i=0; i<objects.size(); ++i) {
+		QObject* o = objects.at(i);
+
+		TimerInfo* info = this->m_object_timers.value(o);
+		while (info) {
+			this->setTimerPriority(info->timerId, priority);
+			info = info->object_next;
+		}
+
+		QSocketNotifier* notifier = qobject_cast<QSocketNotifier*>(o);
+		if (notifier && notifier->thread() == QThread::currentThread()) {
+			this->setSocketPriority(notifier->socket(), priority);
+		}
+	}
+}
+
+/**
+ * @brief Takes a snapshot of the performance counters
+ * @param stats Snapshot
+ */
+void EventDispatcherLibEventPrivate::statistics(EventDispatcherLibEventStatistics& stats) const
+{
+	stats = this->m_stats;
+
+	// Read without the arena's lock: remote frees may be in progress, the numbers are approximate
+	const MemoryArena* arena = this->m_arena;
+	if (arena) {
+		stats.libeventAllocations = arena->allocations() - this->m_arena_allocations_base;
+		stats.libeventFrees       = arena->frees() - this->m_arena_frees_base;
+		stats.libeventBytes       = arena->bytes();
+	}
+}
+
+void EventDispatcherLibEventPrivate::resetStatistics(void)
+{
+	int timers    = this->m_stats.registeredTimers;
+	int notifiers = this->m_stats.registeredNotifiers;
+
+	this->m_stats                     = EventDispatcherLibEventStatistics();
+	this->m_stats.registeredTimers    = timers;
+	this->m_stats.registeredNotifiers = notifiers;
+
+	const MemoryArena* arena = this->m_arena;
+	if (arena) {
+		this->m_arena_allocations_base = arena->allocations();
+		this->m_arena_frees_base       = arena->frees();
+	}
+}
+
+/**
+ * @brief Delivers the activation @a e to its receiver
+ * @param e Activation taken out of the queue
+ * @return Whether an event has been sent
+ */
+bool EventDispatcherLibEventPrivate::deliverEvent(const PendingEvent& e)
+{
+	if (!e.object) {
+		return false;
+	}
+
+	if (EV_TIMEOUT == e.what) {
+		TimerInfo* info = static_cast<TimerInfo*>(e.source);
+		int timer_id    = info->timerId;
+		info->pending   = -1;
+
+		if (Q_UNLIKELY(this->m_exclude_timers)) {
+			// Left over by an iteration which did not exclude timers
+			this->queueTimerEvent(info);
+			return false;
+		}
+
+		struct timeval now;
+		this->readClock(now);
+		qint64 lateness = qMax(EventDispatcherLibEventPrivate::elapsed(info->due, now), qint64(0));
+		++this->m_stats.timerActivations;
+		++this->m_stats.timerLateness[EventDispatcherLibEventPrivate::histogramBucket(lateness)];
+		this->m_stats.totalTimerLateness += lateness;
+		this->m_stats.maxTimerLateness    = qMax(this->m_stats.maxTimerLateness, quint64(lateness));
+
+		QTimerEvent event(timer_id);
+		QCoreApplication::sendEvent(e.object, &event);
+		this->invalidateTime(); // The handler may have taken a while: re-arm the timer from a fresh time
+
+		// The handler has finished (and we returned from the recursion), now the timer can be reactivated
+		info = this->findTimer(timer_id);
+		if (info && info->pending < 0 && info->suppressed < 0 && !this->isTimerScheduled(info)) { // false in tst_QTimer::restartedTimerFiresTooSoon()
+			this->scheduleTimer(info, this->currentTime());
+		}
+	}
+	else {
+		SocketNotifierInfo* data = static_cast<SocketNotifierInfo*>(e.source);
+		if (EV_READ == e.what) {
+			data->pending_read = -1;
+		}
+		else {
+			data->pending_write = -1;
+		}
+
+		if (Q_UNLIKELY(this->m_exclude_notifiers)) {
+			// Left over by an iteration which did not exclude socket notifiers; the backend reports
+			// the descriptor again when it is put back into the loop
+			this->suppressSocketNotifier(data);
+			return false;
+		}
+
+		++(EV_READ == e.what ? this->m_stats.readActivations : this->m_stats.writeActivations);
+
+		QEvent event(QEvent::SockAct);
+		QCoreApplication::sendEvent(e.object, &event);
+		this->invalidateTime();
+	}
+
+	return true;
+}
+
+/**
+ * @return Number of activations waiting to be delivered, cancelled ones included
+ */
+int EventDispatcherLibEventPrivate::pendingEventCount(void) const
+{
+	int count = 0;
+	for (int i=0; i<EventDispatcherLibEventPrivate::PriorityCount; ++i) {
+		count += this->m_event_queues[i].size();
+	}
+
+	return count;
+}
+
+/**
+ * @brief Checks whether the current iteration has used up its dispatch budget
+ * @param delivered Number of events delivered so far
+ * @param deadline Time (monotonic clock) by which the delivery should stop; ignored if there is no time budget
+ * @return Whether the rest of the collected events should be left for the next iteration
+ */
+bool EventDispatcherLibEventPrivate::isDispatchBudgetExhausted(int delivered, const struct timeval& deadline)
+{
+	if (this->m_dispatch_max && delivered >= this->m_dispatch_max) {
+		return true;
+	}
+
+	if (this->m_dispatch_usec) {
+		struct timeval now;
+		EventDispatcherLibEventPrivate::monotonicTime(now);
+		return !evutil_timercmp(&now, &deadline, <);
+	}
+
+	return false;
+}
+
+/**
+ * @brief Polls for events without blocking until something arrives or the spin budget is exhausted
+ * @return Whether the dispatcher should block waiting for events
+ * @retval false An event has been collected, an event has been posted or the loop has been interrupted
+ *
+ * Posted events are noticed through the thread communication object's state, without a system call.
+ */
+bool EventDispatcherLibEventPrivate::busyPoll(void)
+{
+	struct timeval now;
+	struct timeval deadline;
+	struct timeval budget;
+
+	budget.tv_sec  = this->m_busy_poll / 1000000;
+	budget.tv_usec = this->m_busy_poll % 1000000;
+
+	EventDispatcherLibEventPrivate::monotonicTime(now);
+	evutil_timeradd(&now, &budget, &deadline);
+
+	do {
+		this->invalidateTime();
+		event_base_loop(this->m_base, EVLOOP_ONCE | EVLOOP_NONBLOCK);
+		++this->m_stats.nonBlockingPolls;
+
+		if (this->pendingEventCount() || this->m_awaken || this->m_interrupt || this->m_tco->isNotified()) {
+			this->adjustBusyPoll(true, 0);
+			return false;
+		}
+
+		EventDispatcherLibEventPrivate::monotonicTime(now);
+	} while (evutil_timercmp(&now, &deadline, <));
+
+	return true;
+}
+
+/**
+ * @brief Records the outcome of a spin phase and tunes the spin budget
+ * @param hit Whether the spin phase found work (otherwise the dispatcher has blocked)
+ * @param blocked Time spent in the blocking poll (usec); ignored for hits
+ *
+ * The budget is adjusted once per BusyPollWindow outcomes, from the ratio of hits to misses:
+ * it is doubled when most of the blocking waits were short enough to be caught by a longer spin
+ * (and when the budget is zero, this is the only way to start spinning again); it is halved
+ * when less than a quarter of the spin phases found work, since spinning then mostly burns CPU.
+ */
+void EventDispatcherLibEventPrivate::adjustBusyPoll(bool hit, qint64 blocked)
+{
+	if (hit) {
+		++this->m_busy_poll_hits;
+	}
+	else {
+		++this->m_busy_poll_misses;
+		if (blocked <= this->m_busy_poll_max) {
+			++this->m_busy_poll_short;
+		}
+	}
+
+	if (this->m_busy_poll_hits + this->m_busy_poll_misses < EventDispatcherLibEventPrivate::BusyPollWindow) {
+		return;
+	}
+
+	if (this->m_busy_poll_short * 2 > this->m_busy_poll_misses) {
+		this->m_busy_poll = this->m_busy_poll ? qMin(this->m_busy_poll * 2, this->m_busy_poll_max) : qMin(int(EventDispatcherLibEventPrivate::BusyPollMinBudget), this->m_busy_poll_max);
+	}
+	else if (this->m_busy_poll_hits * 4 < EventDispatcherLibEventPrivate::BusyPollWindow) {
+		this->m_busy_poll /= 2;
+		if (this->m_busy_poll < EventDispatcherLibEventPrivate::BusyPollMinBudget) {
+			this->m_busy_poll = 0;
+		}
+	}
+
+	this->m_busy_poll_hits   = 0;
+	this->m_busy_poll_misses = 0;
+	this->m_busy_poll_short  = 0;
+}
+
 /**
  * @brief event_base accessor
  * @return The internal event_base for this dispatcher
@@ -255,5 +642,11 @@ void EventDispatcherLibEventPrivate::wake_up_handler(int fd, short int events, v
 	Q_ASSERT(disp != 0);
 
 	disp->m_awaken = true;
-	disp->m_tco->awaken();
+	++disp->m_stats.wakeUps;
+
+	int consumed = disp->m_tco->awaken();
+	if (consumed > 0) {
+		disp->m_stats.wakeUpSignals += quint64(consumed);
+	}
+	disp->takeTasks();
 }
@@ -2,25 +2,70 @@
 #define EVENTDISPATCHER_LIBEVENT_P_H
 
 #include "common.h"
+#include <QtCore/QMutex>
 #include "tco.h"
+#include "timerwheel_p.h"
+#include "slab_p.h"
+#include "eventqueue_p.h"
+#include "taskqueue_p.h"
+#include "eventdispatcher_libevent_stats.h"
 
 class EventDispatcherLibEvent;
 class EventDispatcherLibEventConfig;
 class EventDispatcherLibEventPrivate;
+class MemoryArena;
 
+/**
+ * @internal
+ * @brief Socket notifiers of a descriptor
+ *
+ * Read and write notifiers of the same descriptor share one libevent event.
+ * When all notifiers of the descriptor are disabled, the record is parked
+ * in the table, so that re-enabling a notifier does not allocate.
+ */
 struct SocketNotifierInfo {
-	QSocketNotifier* sn;
-	struct event* ev;
+	EventDispatcherLibEventPrivate* self;
+	struct event ev;
+	QSocketNotifier* read;
+	QSocketNotifier* write;
+	QSocketNotifier* last_read;  ///< Last read notifier of the descriptor; tells toggles from a new socket on the descriptor
+	QSocketNotifier* last_write; ///< Last write notifier of the descriptor
+	evutil_socket_t fd;
+	short int events;          ///< Events @c ev is assigned for
+	bool edge_triggered;
+	int priority;              ///< Priority class of the notifiers
+	int suppressed;            ///< Index in the list of suppressed descriptors; -1 if the descriptor is not suppressed
+	qint64 pending_read;       ///< Sequence number of the pending read activation; -1 if there is none
+	qint64 pending_write;      ///< Sequence number of the pending write activation; -1 if there is none
 };
 
 struct TimerInfo {
 	EventDispatcherLibEventPrivate* self;
 	QObject* object;
-	struct event* ev;
+	struct event ev;           ///< libevent event; used only by precise timers, coarse ones are managed by the wheel
 	struct timeval when;
 	int timerId;
 	int interval;
 	Qt::TimerType type;
+	TimerInfo* wheel_next;
+	TimerInfo** wheel_pprev;
+	qint64 expires;            ///< Expiration time (msec, clock of the timers)
+	struct timeval due;        ///< Exact expiration time (clock of the timers); timer lateness is measured against it
+	int wheel_slot;            ///< Wheel slot; -1 if not in the wheel
+	TimerInfo* object_prev;    ///< Previous timer of the same object
+	TimerInfo* object_next;    ///< Next timer of the same object
+	int priority;              ///< Priority class
+	int suppressed;            ///< Index in the list of suppressed timers; -1 if the timer is not suppressed
+	qint64 pending;            ///< Sequence number of the pending activation; -1 if there is none
+};
+
+/**
+ * @internal
+ * @brief Dispatchers which steal stealable tasks from each other
+ */
+struct WorkStealingGroup {
+	QMutex lock;
+	QVector<EventDispatcherLibEventPrivate*> members; ///< Protected by @c lock; a destroyed dispatcher leaves the group
 };
 
 Q_DECLARE_TYPEINFO(SocketNotifierInfo, Q_PRIMITIVE_TYPE);
@@ -28,24 +73,60 @@ Q_DECLARE_TYPEINFO(TimerInfo, Q_PRIMITIVE_TYPE);
 
 class Q_DECL_HIDDEN EventDispatcherLibEventPrivate {
 public:
-	EventDispatcherLibEventPrivate(EventDispatcherLibEvent* const q);
-	EventDispatcherLibEventPrivate(EventDispatcherLibEvent* const q, const EventDispatcherLibEventConfig& cfg);
+	EventDispatcherLibEventPrivate(EventDispatcherLibEvent* const q, const EventDispatcherLibEventConfig* cfg = 0);
 	~EventDispatcherLibEventPrivate(void);
 	bool processEvents(QEventLoop::ProcessEventsFlags flags);
 	void registerSocketNotifier(QSocketNotifier* notifier);
 	void unregisterSocketNotifier(QSocketNotifier* notifier);
+	bool setEdgeTriggered(evutil_socket_t fd, bool enable);
 	void registerTimer(int timerId, int interval, Qt::TimerType type, QObject* object);
 	bool unregisterTimer(int timerId);
 	bool unregisterTimers(QObject* object);
 	QList<QAbstractEventDispatcher::TimerInfo> registeredTimers(QObject* object) const;
 	int remainingTime(int timerId) const;
+	bool postTask(void (*func)(void*), void* context, void (*dispose)(void*));
+	bool postStealableTask(void (*func)(void*), void* context, void (*dispose)(void*));
+	static void enableWorkStealing(const QList<EventDispatcherLibEvent*>& dispatchers);
+	bool migrate(const QList<QObject*>& objects, EventDispatcherLibEvent* target, void (*done)(void*), void* context);
+	bool setSocketPriority(evutil_socket_t fd, int priority);
+	bool setTimerPriority(int timerId, int priority);
+	void setObjectPriority(QObject* object, int priority);
+	void statistics(EventDispatcherLibEventStatistics& stats) const;
+	void resetStatistics(void);
+	void setClock(qint64 (*func)(void*), void* context);
+	void setVirtualClock(qint64 start);
+	bool isVirtualClock(void) const;
+	qint64 clockTime(void) const;
+	int advanceClock(qint64 usec);
 
 	struct event_base* eventBase(void) const;
 
-	typedef QMultiHash<evutil_socket_t, SocketNotifierInfo> SocketNotifierHash;
-	typedef QHash<int, TimerInfo*> TimerHash;
-	typedef QPair<QPointer<QObject>, QEvent*> PendingEvent;
-	typedef QList<PendingEvent> EventList;
+	/// Number of priority classes, see EventDispatcherLibEvent::Priority
+	enum {
+		PriorityCount   = 3,
+		DefaultPriority = 1
+	};
+
+	/// Number of spin phase outcomes between two adjustments of the busy-poll budget, and the smallest budget (usec)
+	enum {
+		BusyPollWindow    = 16,
+		BusyPollMinBudget = 10
+	};
+
+	/// Maximum number of records without notifiers kept in the hash-backed notifier table
+	enum { MaxParkedNotifiers = 256 };
+
+#ifdef Q_OS_WIN
+	// SOCKETs are opaque handles on Windows
+	typedef QHash<evutil_socket_t, SocketNotifierInfo*> SocketNotifierTable;
+#else
+	// Descriptors are small dense integers: index the table by descriptor
+	typedef QVector<SocketNotifierInfo*> SocketNotifierTable;
+#endif
+	typedef QVector<TimerInfo*> TimerIndex;
+	typedef QHash<QObject*, TimerInfo*> ObjectTimerHash;
+	typedef QVector<SocketNotifierInfo*> SuppressedNotifierList;
+	typedef QVector<TimerInfo*> SuppressedTimerList;
 
 private:
 	Q_DISABLE_COPY(EventDispatcherLibEventPrivate)
@@ -55,25 +136,109 @@ private:
 	bool m_interrupt;
 	struct event_base* m_base;
 	struct event* m_wakeup;
+	struct event* m_wheel_ev;
 	ThreadCommunicationObject* m_tco;
-	SocketNotifierHash m_notifiers;
-	TimerHash m_timers;
-	EventList m_event_list;
+	SocketNotifierTable m_notifiers;
+	SlabAllocator<SocketNotifierInfo> m_notifier_slab;
+	int m_parked_notifiers;    ///< Records in m_notifiers without notifiers
+	TimerIndex m_timers;        ///< Indexed by timerSlot()
+	SlabAllocator<TimerInfo> m_timer_slab;
+	ObjectTimerHash m_object_timers;
+	TimerWheel m_wheel;
+	qint64 m_wheel_armed;
+	PendingEventQueue m_event_queues[PriorityCount]; ///< Pending activations, one queue per priority class
+	SuppressedNotifierList m_suppressed_notifiers;
+	SuppressedTimerList m_suppressed_timers;
+	bool m_exclude_notifiers;
+	bool m_edge_triggered;
+	bool m_exclude_timers;
 	bool m_awaken;
+	TaskQueue m_task_queue;
+	TaskNodePool m_task_nodes; ///< Nodes of posted tasks, recycled
+	TaskNode* m_tasks;         ///< Tasks taken out of m_task_queue and waiting to be run
+	TaskNode** m_tasks_tail;
+	QMutex m_shared_lock;
+	TaskNode* m_shared_tasks;  ///< Stealable tasks; protected by m_shared_lock
+	TaskNode** m_shared_tail;
+	WorkStealingGroup* m_group;
+	int m_busy_poll_max;       ///< Maximum spin time before blocking (usec); 0 if busy polling is disabled
+	int m_busy_poll;           ///< Current spin budget (usec)
+	int m_busy_poll_hits;      ///< Spin phases which found work, since the last adjustment of the budget
+	int m_busy_poll_misses;    ///< Blocking waits, since the last adjustment of the budget
+	int m_busy_poll_short;     ///< Blocking waits no longer than m_busy_poll_max
+	int m_dispatch_usec;       ///< Time budget for delivering collected events per iteration (usec); 0 if unlimited
+	int m_dispatch_max;        ///< Maximum number of events collected and delivered per iteration; 0 if unlimited
+	EventDispatcherLibEventStatistics m_stats; ///< Updated only by the dispatcher's thread
+	MemoryArena* m_arena;      ///< Arena for libevent's allocations on behalf of the dispatcher; 0 if the arena allocator is not installed
+	bool m_arena_bound;        ///< Whether m_arena has been bound to the dispatcher's thread
+	quint64 m_arena_allocations_base; ///< Counters of m_arena at the last resetStatistics()
+	quint64 m_arena_frees_base;
+	qint64 (*m_clock)(void*);  ///< Clock of the timers (usec); 0 for the monotonic clock
+	void* m_clock_context;
+	qint64 m_virtual_time;     ///< Time of the virtual clock (usec)
+	mutable bool m_now_valid;
+	mutable struct timeval m_now;
+	int m_loop_level;          ///< Nesting level of processEvents(); the clock is cached only inside the loop
 
 	void initialize(const EventDispatcherLibEventConfig* cfg);
+	bool busyPoll(void);
+	bool isDispatchBudgetExhausted(int delivered, const struct timeval& deadline);
+	int pendingEventCount(void) const;
+	bool deliverEvent(const PendingEvent& e);
+	void adjustBusyPoll(bool hit, qint64 blocked);
 
 	static void calculateCoarseTimerTimeout(TimerInfo* info, const struct timeval& now, struct timeval& when);
 	static void calculateNextTimeout(TimerInfo* info, const struct timeval& now, struct timeval& delta);
+	static qint64 toMsec(const struct timeval& tv, bool round_up);
+	static qint64 toUsec(const struct timeval& tv);
+	static qint64 elapsed(const struct timeval& from, const struct timeval& to);
+	static int histogramBucket(quint64 value);
+	static void monotonicTime(struct timeval& tv);
+	static qint64 virtual_clock(void* arg);
+
+	void readClock(struct timeval& tv) const;
+	const struct timeval& currentTime(void) const;
+	void invalidateTime(void);
+
+	static int timerSlot(int timerId);
+	TimerInfo* findTimer(int timerId) const;
+	void freeTimer(TimerInfo* info);
+	void releaseTimer(TimerInfo* info);
+	void scheduleTimer(TimerInfo* info, const struct timeval& now);
+	void cancelTimer(TimerInfo* info);
+	bool isTimerScheduled(TimerInfo* info) const;
+	void armTimerWheel(qint64 now);
+	void expireTimers(void);
+	void queueTimerEvent(TimerInfo* info);
 
 	static void socket_notifier_callback(evutil_socket_t fd, short int events, void* arg);
 	static void timer_callback(evutil_socket_t fd, short int events, void* arg);
+	static void wheel_callback(evutil_socket_t fd, short int events, void* arg);
 	static void wake_up_handler(evutil_socket_t fd, short int events, void* arg);
 
-	bool disableSocketNotifiers(bool disable);
+	SocketNotifierInfo* findSocketNotifier(evutil_socket_t fd) const;
+	SocketNotifierInfo* createSocketNotifier(evutil_socket_t fd);
+	void updateSocketNotifier(SocketNotifierInfo* data);
+	void queueSocketEvent(SocketNotifierInfo* data, short int what);
+	void cancelSocketEvent(SocketNotifierInfo* data, QSocketNotifier* notifier);
+	void suppressSocketNotifier(SocketNotifierInfo* data);
+	void unsuppressSocketNotifier(SocketNotifierInfo* data);
+	bool resumeSocketNotifiers(void);
 	void killSocketNotifiers(void);
-	bool disableTimers(bool disable);
+	void unsuppressTimer(TimerInfo* info);
+	bool resumeTimers(void);
 	void killTimers(void);
+
+	void takeTasks(void);
+	bool runTasks(void);
+	void discardTasks(void);
+	TaskNode* takeSharedTask(void);
+	bool runSharedTask(bool steal);
+	void leaveWorkStealingGroup(void);
+
+	static void migrate_detach(void* arg);
+	static void migrate_attach(void* arg);
+	static void migrate_dispose(void* arg);
 };
 
 #endif // EVENTDISPATCHER_LIBEVENT_P_H
@@ -0,0 +1,643 @@
+#include "common.h"
+#include <QtCore/QByteArray>
+#include "eventdispatcher_libevent.h"
+#include "eventdispatcher_libevent_config.h"
+#include "eventdispatcher_libevent_pool.h"
+#include "eventdispatcher_libevent_pool_p.h"
+
+#ifdef Q_OS_LINUX
+#	include <sched.h>
+#endif
+
+#ifndef Q_OS_WIN
+#	include <errno.h>
+#	include <sys/socket.h>
+#endif
+
+/**
+ * @class EventDispatcherLibEventPool
+ * @brief The EventDispatcherLibEventPool class runs a set of threads with EventDispatcherLibEvent event loops
+ *
+ * The pool accepts connections on behalf of a server: every thread of the pool watches
+ * the listening addresses registered with listen() and hands the accepted descriptors
+ * to the handler in the same thread. The objects created by the handler (e.g. @c QTcpSocket
+ * with the descriptor set by @c setSocketDescriptor()) live in that thread right away,
+ * no central acceptor thread and no @c moveToThread() are involved.
+ *
+ * @note The pool requires Qt 5: Qt 4 does not allow to install a custom event dispatcher into a thread
+ */
+
+/**
+ * Constructs a pool of @a size threads with the default configuration of the dispatchers
+ *
+ * @param size Number of threads; if it is not positive, QThread::idealThreadCount() threads are created
+ * @param parent Parent
+ */
+EventDispatcherLibEventPool::EventDispatcherLibEventPool(int size, QObject* parent)
+	: QObject(parent), d_ptr(new EventDispatcherLibEventPoolPrivate(this, size, 0))
+{
+}
+
+/**
+ * Constructs a pool of @a size threads with the dispatchers configured by @a config
+ *
+ * @param size Number of threads; if it is not positive, QThread::idealThreadCount() threads are created
+ * @param config Configuration of the dispatchers; it is not needed after the constructor returns
+ * @param parent Parent
+ */
+EventDispatcherLibEventPool::EventDispatcherLibEventPool(int size, const EventDispatcherLibEventConfig& config, QObject* parent)
+	: QObject(parent), d_ptr(new EventDispatcherLibEventPoolPrivate(this, size, &config))
+{
+}
+
+/**
+ * Stops the pool and destroys it
+ */
+EventDispatcherLibEventPool::~EventDispatcherLibEventPool(void)
+{
+}
+
+/**
+ * Pins the threads of the pool to CPUs, one thread per core
+ *
+ * The threads are spread over the CPUs of the affinity mask of the thread which calls start();
+ * if there are more threads than CPUs, several threads share a CPU.
+ *
+ * @param enable Whether to pin the threads
+ * @return Whether the setting has been accepted
+ * @retval false If the pool is running or if the platform does not support thread affinity
+ */
+bool EventDispatcherLibEventPool::setCpuAffinity(bool enable)
+{
+#ifdef Q_OS_LINUX
+	Q_D(EventDispatcherLibEventPool);
+	if (d->m_state != EventDispatcherLibEventPoolPrivate::NotStarted) {
+		return false;
+	}
+
+	d->m_affinity = enable;
+	return true;
+#else
+	return !enable;
+#endif
+}
+
+/**
+ * Lets the threads of the pool steal stealable tasks from each other
+ *
+ * @param enable Whether to enable work stealing
+ * @return Whether the setting has been accepted
+ * @retval false If the pool has already been started
+ * @see EventDispatcherLibEvent::postStealableTask()
+ */
+bool EventDispatcherLibEventPool::setWorkStealing(bool enable)
+{
+	Q_D(EventDispatcherLibEventPool);
+	if (d->m_state != EventDispatcherLibEventPoolPrivate::NotStarted) {
+		return false;
+	}
+
+	d->m_stealing = enable;
+	return true;
+}
+
+/**
+ * Starts the threads of the pool
+ *
+ * @return Whether the threads have been started
+ * @retval false If the pool has already been started; a pool can be started only once
+ */
+bool EventDispatcherLibEventPool::start(void)
+{
+	Q_D(EventDispatcherLibEventPool);
+	return d->start();
+}
+
+/**
+ * Stops accepting connections and stops the threads of the pool
+ *
+ * The event loops of the threads are exited; the function returns when all threads have finished
+ */
+void EventDispatcherLibEventPool::stop(void)
+{
+	Q_D(EventDispatcherLibEventPool);
+	d->stop();
+}
+
+bool EventDispatcherLibEventPool::isRunning(void) const
+{
+	Q_D(const EventDispatcherLibEventPool);
+	return EventDispatcherLibEventPoolPrivate::Running == d->m_state;
+}
+
+/**
+ * @return Number of threads in the pool
+ */
+int EventDispatcherLibEventPool::size(void) const
+{
+	Q_D(const EventDispatcherLibEventPool);
+	return d->m_threads.size();
+}
+
+/**
+ * @param index Index of the thread
+ * @return Thread; 0 if @a index is out of range
+ */
+QThread* EventDispatcherLibEventPool::threadAt(int index) const
+{
+	Q_D(const EventDispatcherLibEventPool);
+	return (index >= 0 && index < d->m_threads.size()) ? d->m_threads.at(index) : 0;
+}
+
+/**
+ * @param index Index of the thread
+ * @return Event dispatcher of the thread; 0 if @a index is out of range or the pool has been stopped
+ */
+EventDispatcherLibEvent* EventDispatcherLibEventPool::dispatcherAt(int index) const
+{
+	Q_D(const EventDispatcherLibEventPool);
+	return (index >= 0 && index < d->m_threads.size()) ? d->m_threads.at(index)->dispatcher : 0;
+}
+
+/**
+ * Accepts connections on @a address in all threads of the pool
+ *
+ * @param address Address to listen on, in one of the forms accepted by @c evutil_parse_sockaddr_port():
+ * "1.2.3.4:80", "[::1]:8080" etc
+ * @param handler Function called in the accepting thread for every accepted connection with the descriptor,
+ * the index of the thread and @a context. It is called by the event loop of the thread after the libevent
+ * callback has returned, so it may use any Qt API, including nested event loops
+ * @param context Argument for @a handler
+ * @param mode How the threads share the address
+ * @return Whether the address has been registered
+ *
+ * In @c ReusePort mode every thread gets its own socket bound with @c SO_REUSEPORT, and the kernel spreads
+ * incoming connections between them; if one of the sockets cannot be created, none of them is kept.
+ * In @c Shared mode all threads watch the same socket; every activation accepts a single connection,
+ * so that a burst is spread between the threads which woke up.
+ *
+ * When the process runs out of descriptors, a thread stops accepting connections on the address
+ * for 100 ms instead of spinning on the pending connection.
+ *
+ * Accepted connections are counted per thread; call connectionClosed() when a connection is closed
+ * to keep connectionCount() accurate.
+ *
+ * @note The function can be called both before and after start()
+ * @warning Not available with libevent 1.x
+ */
+bool EventDispatcherLibEventPool::listen(const QByteArray& address, AcceptHandler handler, void* context, ListenMode mode)
+{
+	if (!handler) {
+		qWarning("%s: invalid arguments", Q_FUNC_INFO);
+		return false;
+	}
+
+	Q_D(EventDispatcherLibEventPool);
+	return d->listen(address, handler, context, mode);
+}
+
+/**
+ * @param index Index of the thread
+ * @return Number of the connections accepted by the thread and not reported as closed by connectionClosed()
+ */
+int EventDispatcherLibEventPool::connectionCount(int index) const
+{
+	Q_D(const EventDispatcherLibEventPool);
+	if (index >= 0 && index < d->m_threads.size()) {
+		return d->m_threads.at(index)->connections.load();
+	}
+
+	return 0;
+}
+
+/**
+ * Reports that a connection accepted by the thread @a index has been closed. Thread-safe
+ *
+ * @param index Index of the thread, as passed to the accept handler
+ */
+void EventDispatcherLibEventPool::connectionClosed(int index)
+{
+	Q_D(EventDispatcherLibEventPool);
+	if (index >= 0 && index < d->m_threads.size()) {
+		d->m_threads.at(index)->connections.deref();
+	}
+}
+
+
+EventDispatcherLibEventPoolThread::EventDispatcherLibEventPoolThread(int index, int cpu, QSemaphore* started)
+	: QThread(), dispatcher(0), index(index), cpu(cpu), connections(0), listeners(), accepted(), warned(), pauses(0), m_started(started)
+{
+}
+
+void EventDispatcherLibEventPoolThread::run(void)
+{
+#ifdef Q_OS_LINUX
+	if (this->cpu >= 0) {
+		cpu_set_t set;
+		CPU_ZERO(&set);
+		CPU_SET(this->cpu, &set);
+		if (-1 == sched_setaffinity(0, sizeof(set), &set)) {
+			qErrnoWarning("%s: sched_setaffinity() failed", Q_FUNC_INFO);
+		}
+	}
+#endif
+
+	this->m_started->release();
+	this->exec();
+}
+
+/**
+ * @brief Starts watching the listening socket; runs in the thread of the listener
+ * @param arg Listener
+ */
+void EventDispatcherLibEventPoolThread::addListener(void* arg)
+{
+	EventDispatcherLibEventPoolListener* listener = static_cast<EventDispatcherLibEventPoolListener*>(arg);
+	EventDispatcherLibEventPoolThread* self       = listener->thread;
+
+	listener->ev = event_new(self->dispatcher->eventBase(), listener->fd, EV_READ | EV_PERSIST, EventDispatcherLibEventPoolThread::accept_callback, listener);
+	Q_CHECK_PTR(listener->ev);
+	listener->retry = event_new(self->dispatcher->eventBase(), -1, 0, EventDispatcherLibEventPoolThread::retry_callback, listener);
+	Q_CHECK_PTR(listener->retry);
+	event_add(listener->ev, 0);
+	self->listeners.append(listener);
+}
+
+/**
+ * @brief Stops watching the listening sockets and exits the event loop; runs in the thread
+ * @param arg Thread
+ */
+void EventDispatcherLibEventPoolThread::shutdown(void* arg)
+{
+	EventDispatcherLibEventPoolThread* self = static_cast<EventDispatcherLibEventPoolThread*>(arg);
+	for (int i=0; i<self->listeners.size(); ++i) {
+		EventDispatcherLibEventPoolListener* listener = self->listeners.at(i);
+		event_free(listener->ev);
+		event_free(listener->retry);
+		listener->ev    = 0;
+		listener->retry = 0;
+	}
+
+	self->listeners.clear();
+
+	// The handlers will not run anymore
+	for (int i=0; i<self->accepted.size(); ++i) {
+		evutil_closesocket(self->accepted.at(i).fd);
+		self->connections.deref();
+	}
+
+	self->accepted.clear();
+	self->quit();
+}
+
+/**
+ * @brief Passes the accepted connections to their handlers; runs in the thread
+ * @param arg Thread
+ *
+ * The handlers are not called from the libevent callback: like any other Qt code, they may start
+ * a nested event loop or delete objects, which is safe only outside event_base_loop().
+ */
+void EventDispatcherLibEventPoolThread::deliverConnections(void* arg)
+{
+	EventDispatcherLibEventPoolThread* self = static_cast<EventDispatcherLibEventPoolThread*>(arg);
+
+	// Connections accepted by a nested event loop of a handler are delivered by the task it posts
+	QVector<EventDispatcherLibEventPoolConnection> accepted;
+	accepted.swap(self->accepted);
+
+	for (int i=0; i<accepted.size(); ++i) {
+		const EventDispatcherLibEventPoolConnection& c = accepted.at(i);
+		c.listener->handler(c.fd, self->index, c.listener->context);
+	}
+}
+
+void EventDispatcherLibEventPoolThread::accept_callback(evutil_socket_t fd, short int events, void* arg)
+{
+	Q_UNUSED(events)
+
+	EventDispatcherLibEventPoolListener* listener = static_cast<EventDispatcherLibEventPoolListener*>(arg);
+	EventDispatcherLibEventPoolThread* self       = listener->thread;
+
+	for (;;) {
+		evutil_socket_t conn = ::accept(fd, 0, 0);
+		if (conn < 0) {
+#ifndef Q_OS_WIN
+			if (EINTR == errno) {
+				continue;
+			}
+
+			// The pending connection stays in the backlog, and a level-triggered listener would spin on it
+			if (EMFILE == errno || ENFILE == errno || ENOBUFS == errno || ENOMEM == errno) {
+				self->pauseListener(listener);
+			}
+			else if (EAGAIN != errno && EWOULDBLOCK != errno && ECONNABORTED != errno) {
+				qErrnoWarning("%s: accept() failed", Q_FUNC_INFO);
+			}
+#endif
+			break;
+		}
+
+		evutil_make_socket_closeonexec(conn);
+		self->connections.ref();
+
+		if (self->accepted.isEmpty()) {
+			self->dispatcher->postTask(EventDispatcherLibEventPoolThread::deliverConnections, self);
+		}
+
+		EventDispatcherLibEventPoolConnection c;
+		c.listener = listener;
+		c.fd       = conn;
+		self->accepted.append(c);
+
+		// A shared socket is watched by all threads: take one connection and let the others have the rest
+		if (!listener->owns_fd) {
+			break;
+		}
+	}
+}
+
+/**
+ * @brief Stops watching the listening socket for AcceptRetryInterval milliseconds
+ * @param listener Listener
+ *
+ * Called when accept() fails for lack of descriptors or memory. The warning is issued
+ * at most once per WarningInterval milliseconds, with the number of pauses since the previous one.
+ */
+void EventDispatcherLibEventPoolThread::pauseListener(EventDispatcherLibEventPoolListener* listener)
+{
+	++this->pauses;
+	if (!this->warned.isValid() || this->warned.elapsed() >= EventDispatcherLibEventPoolThread::WarningInterval) {
+		qErrnoWarning("%s: accept() failed, listener paused for %d ms (%d pause(s) since the last warning)", Q_FUNC_INFO, int(EventDispatcherLibEventPoolThread::AcceptRetryInterval), this->pauses);
+		this->warned.start();
+		this->pauses = 0;
+	}
+
+	struct timeval tv;
+	tv.tv_sec  = 0;
+	tv.tv_usec = EventDispatcherLibEventPoolThread::AcceptRetryInterval * 1000;
+
+	event_del(listener->ev);
+	event_add(listener->retry, &tv);
+}
+
+/**
+ * @brief Resumes watching the listening socket after pauseListener()
+ * @param fd Unused
+ * @param events Unused
+ * @param arg Listener
+ */
+void EventDispatcherLibEventPoolThread::retry_callback(evutil_socket_t fd, short int events, void* arg)
+{
+	Q_UNUSED(fd)
+	Q_UNUSED(events)
+
+	EventDispatcherLibEventPoolListener* listener = static_cast<EventDispatcherLibEventPoolListener*>(arg);
+	event_add(listener->ev, 0);
+}
+
+EventDispatcherLibEventPoolPrivate::EventDispatcherLibEventPoolPrivate(EventDispatcherLibEventPool* const q, int size, const EventDispatcherLibEventConfig* config)
+	: q_ptr(q), m_state(EventDispatcherLibEventPoolPrivate::NotStarted), m_affinity(false), m_stealing(false), m_threads(), m_listeners(), m_sockets(), m_started()
+{
+	if (size <= 0) {
+		size = qMax(QThread::idealThreadCount(), 1);
+	}
+
+	this->m_threads.reserve(size);
+	for (int i=0; i<size; ++i) {
+		EventDispatcherLibEventPoolThread* thread = new EventDispatcherLibEventPoolThread(i, -1, &this->m_started);
+		thread->dispatcher = config ? new EventDispatcherLibEvent(*config) : new EventDispatcherLibEvent();
+		thread->setEventDispatcher(thread->dispatcher);
+		this->m_threads.append(thread);
+	}
+}
+
+EventDispatcherLibEventPoolPrivate::~EventDispatcherLibEventPoolPrivate(void)
+{
+	this->stop();
+
+	for (int i=0; i<this->m_threads.size(); ++i) {
+		EventDispatcherLibEventPoolThread* thread = this->m_threads.at(i);
+		if (EventDispatcherLibEventPoolPrivate::NotStarted == this->m_state) {
+			// The thread has not run, so it has not taken care of its dispatcher
+			delete thread->dispatcher;
+		}
+
+		delete thread;
+	}
+
+	qDeleteAll(this->m_listeners);
+}
+
+bool EventDispatcherLibEventPoolPrivate::start(void)
+{
+	if (this->m_state != EventDispatcherLibEventPoolPrivate::NotStarted) {
+		return false;
+	}
+
+	if (this->m_stealing) {
+		QList<EventDispatcherLibEvent*> dispatchers;
+		for (int i=0; i<this->m_threads.size(); ++i) {
+			dispatchers.append(this->m_threads.at(i)->dispatcher);
+		}
+
+		EventDispatcherLibEvent::enableWorkStealing(dispatchers);
+	}
+
+	QVector<int> cpus;
+	if (this->m_affinity) {
+		cpus = EventDispatcherLibEventPoolPrivate::allowedCpus();
+	}
+
+	for (int i=0; i<this->m_threads.size(); ++i) {
+		EventDispatcherLibEventPoolThread* thread = this->m_threads.at(i);
+		thread->cpu = cpus.isEmpty() ? -1 : cpus.at(i % cpus.size());
+		thread->start();
+	}
+
+	this->m_started.acquire(this->m_threads.size());
+	this->m_state = EventDispatcherLibEventPoolPrivate::Running;
+
+	for (int i=0; i<this->m_listeners.size(); ++i) {
+		this->postListener(this->m_listeners.at(i));
+	}
+
+	return true;
+}
+
+void EventDispatcherLibEventPoolPrivate::stop(void)
+{
+	if (this->m_state != EventDispatcherLibEventPoolPrivate::Running) {
+		return;
+	}
+
+	for (int i=0; i<this->m_threads.size(); ++i) {
+		EventDispatcherLibEventPoolThread* thread = this->m_threads.at(i);
+		thread->dispatcher->postTask(EventDispatcherLibEventPoolThread::shutdown, thread);
+	}
+
+	for (int i=0; i<this->m_threads.size(); ++i) {
+		EventDispatcherLibEventPoolThread* thread = this->m_threads.at(i);
+		thread->wait();
+		// QThread destroys the event dispatcher when the thread finishes
+		thread->dispatcher = 0;
+	}
+
+	for (int i=0; i<this->m_sockets.size(); ++i) {
+		evutil_closesocket(this->m_sockets.at(i));
+	}
+
+	this->m_sockets.clear();
+	this->m_state = EventDispatcherLibEventPoolPrivate::Stopped;
+}
+
+bool EventDispatcherLibEventPoolPrivate::listen(const QByteArray& address, EventDispatcherLibEventPool::AcceptHandler handler, void* context, EventDispatcherLibEventPool::ListenMode mode)
+{
+#ifndef SJ_LIBEVENT_EMULATION
+	if (EventDispatcherLibEventPoolPrivate::Stopped == this->m_state) {
+		return false;
+	}
+
+	struct sockaddr_storage ss;
+	int len = sizeof(ss);
+	if (-1 == evutil_parse_sockaddr_port(address.constData(), reinterpret_cast<struct sockaddr*>(&ss), &len)) {
+		qWarning("%s: invalid address '%s'", Q_FUNC_INFO, address.constData());
+		return false;
+	}
+
+	const bool reuse_port = (EventDispatcherLibEventPool::ReusePort == mode);
+	evutil_socket_t shared = -1;
+	QVector<evutil_socket_t> sockets; // One per thread in ReusePort mode
+
+	if (!reuse_port) {
+		shared = EventDispatcherLibEventPoolPrivate::createSocket(reinterpret_cast<struct sockaddr*>(&ss), len, false);
+		if (-1 == shared) {
+			return false;
+		}
+
+		this->m_sockets.append(shared);
+	}
+	else {
+		// All sockets are created before any of them is handed to a thread, so that a failure leaves nothing listening
+		for (int i=0; i<this->m_threads.size(); ++i) {
+			evutil_socket_t fd = EventDispatcherLibEventPoolPrivate::createSocket(reinterpret_cast<struct sockaddr*>(&ss), len, true);
+			if (-1 == fd) {
+				for (int j=0; j<sockets.size(); ++j) {
+					evutil_closesocket(sockets.at(j));
+				}
+
+				return false;
+			}
+
+			sockets.append(fd);
+		}
+
+		for (int i=0; i<sockets.size(); ++i) {
+			this->m_sockets.append(sockets.at(i));
+		}
+	}
+
+	for (int i=0; i<this->m_threads.size(); ++i) {
+		EventDispatcherLibEventPoolListener* listener = new EventDispatcherLibEventPoolListener;
+		listener->thread  = this->m_threads.at(i);
+		listener->fd      = reuse_port ? sockets.at(i) : shared;
+		listener->owns_fd = reuse_port;
+		listener->ev      = 0;
+		listener->retry   = 0;
+		listener->handler = handler;
+		listener->context = context;
+
+		this->m_listeners.append(listener);
+		if (EventDispatcherLibEventPoolPrivate::Running == this->m_state) {
+			this->postListener(listener);
+		}
+	}
+
+	return true;
+#else
+	Q_UNUSED(address)
+	Q_UNUSED(handler)
+	Q_UNUSED(context)
+	Q_UNUSED(mode)
+	return false;
+#endif
+}
+
+void EventDispatcherLibEventPoolPrivate::postListener(EventDispatcherLibEventPoolListener* listener)
+{
+	listener->thread->dispatcher->postTask(EventDispatcherLibEventPoolThread::addListener, listener);
+}
+
+/**
+ * @brief CPUs the process may run on
+ * @return Indices of the CPUs in the affinity mask of the calling thread; empty on failure
+ *
+ * The mask may be narrower than QThread::idealThreadCount() (taskset, cgroups, container limits):
+ * pinning a thread to a CPU outside of it would fail.
+ */
+QVector<int> EventDispatcherLibEventPoolPrivate::allowedCpus(void)
+{
+	QVector<int> res;
+#ifdef Q_OS_LINUX
+	cpu_set_t set;
+	CPU_ZERO(&set);
+	if (-1 == sched_getaffinity(0, sizeof(set), &set)) {
+		qErrnoWarning("%s: sched_getaffinity() failed", Q_FUNC_INFO);
+		return res;
+	}
+
+	for (int cpu=0; cpu<CPU_SETSIZE; ++cpu) {
+		if (CPU_ISSET(cpu, &set)) {
+			res.append(cpu);
+		}
+	}
+#endif
+
+	return res;
+}
+
+/**
+ * @brief Creates a non-blocking listening socket
+ * @param addr Address to bind to
+ * @param len Length of @a addr
+ * @param reuse_port Whether to set @c SO_REUSEPORT
+ * @return Socket
+ * @retval -1 Failure
+ */
+evutil_socket_t EventDispatcherLibEventPoolPrivate::createSocket(const struct sockaddr* addr, int len, bool reuse_port)
+{
+#ifndef SO_REUSEPORT
+	if (reuse_port) {
+		qWarning("%s: SO_REUSEPORT is not supported on this platform", Q_FUNC_INFO);
+		return -1;
+	}
+#endif
+
+	evutil_socket_t fd = ::socket(addr->sa_family, SOCK_STREAM, 0);
+	if (-1 == fd) {
+		qErrnoWarning("%s: socket() failed", Q_FUNC_INFO);
+		return -1;
+	}
+
+	evutil_make_socket_closeonexec(fd);
+	evutil_make_socket_nonblocking(fd);
+	evutil_make_listen_socket_reuseable(fd);
+
+#ifdef SO_REUSEPORT
+	if (reuse_port) {
+		int on = 1;
+		if (-1 == ::setsockopt(fd, SOL_SOCKET, SO_REUSEPORT, reinterpret_cast<const char*>(&on), sizeof(on))) {
+			qErrnoWarning("%s: setsockopt(SO_REUSEPORT) failed", Q_FUNC_INFO);
+			evutil_closesocket(fd);
+			return -1;
+		}
+	}
+#endif
+
+	if (-1 == ::bind(fd, addr, len) || -1 == ::listen(fd, SOMAXCONN)) {
+		qErrnoWarning("%s: failed to listen", Q_FUNC_INFO);
+		evutil_closesocket(fd);
+		return -1;
+	}
+
+	return fd;
+}
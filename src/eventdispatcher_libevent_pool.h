@@ -0,0 +1,52 @@
+#ifndef EVENTDISPATCHER_LIBEVENT_POOL_H
+#define EVENTDISPATCHER_LIBEVENT_POOL_H
+
+#include <QtCore/QObject>
+#include <QtCore/QScopedPointer>
+
+QT_BEGIN_NAMESPACE
+class QByteArray;
+class QThread;
+QT_END_NAMESPACE
+
+class EventDispatcherLibEvent;
+class EventDispatcherLibEventConfig;
+class EventDispatcherLibEventPoolPrivate;
+
+class EventDispatcherLibEventPool : public QObject {
+	Q_OBJECT
+public:
+	explicit EventDispatcherLibEventPool(int size = 0, QObject* parent = 0);
+	EventDispatcherLibEventPool(int size, const EventDispatcherLibEventConfig& config, QObject* parent = 0);
+	virtual ~EventDispatcherLibEventPool(void);
+
+	enum ListenMode {
+		ReusePort,
+		Shared
+	};
+
+	typedef void (*AcceptHandler)(qintptr fd, int index, void* context);
+
+	bool setCpuAffinity(bool enable);
+	bool setWorkStealing(bool enable);
+
+	bool start(void);
+	void stop(void);
+	bool isRunning(void) const;
+
+	int size(void) const;
+	QThread* threadAt(int index) const;
+	EventDispatcherLibEvent* dispatcherAt(int index) const;
+
+	bool listen(const QByteArray& address, AcceptHandler handler, void* context, ListenMode mode = ReusePort);
+
+	int connectionCount(int index) const;
+	void connectionClosed(int index);
+
+private:
+	Q_DISABLE_COPY(EventDispatcherLibEventPool)
+	Q_DECLARE_PRIVATE(EventDispatcherLibEventPool)
+	QScopedPointer<EventDispatcherLibEventPoolPrivate> d_ptr;
+};
+
+#endif // EVENTDISPATCHER_LIBEVENT_POOL_H
@@ -0,0 +1,104 @@
+#ifndef EVENTDISPATCHER_LIBEVENT_POOL_P_H
+#define EVENTDISPATCHER_LIBEVENT_POOL_P_H
+
+#include "common.h"
+#include <QtCore/QAtomicInt>
+#include <QtCore/QElapsedTimer>
+#include <QtCore/QSemaphore>
+#include <QtCore/QVector>
+#include "eventdispatcher_libevent_pool.h"
+
+class EventDispatcherLibEventPoolThread;
+
+/**
+ * @internal
+ * @brief Listening socket watched by one pool thread
+ */
+struct EventDispatcherLibEventPoolListener {
+	EventDispatcherLibEventPoolThread* thread;
+	evutil_socket_t fd;
+	bool owns_fd;              ///< Whether the socket belongs to this listener only (EventDispatcherLibEventPool::ReusePort)
+	struct event* ev;          ///< Created and destroyed in the thread
+	struct event* retry;       ///< Timer which resumes accepting after the process has run out of descriptors
+	EventDispatcherLibEventPool::AcceptHandler handler;
+	void* context;
+};
+
+/**
+ * @internal
+ * @brief Connection accepted by a pool thread and waiting for its handler
+ */
+struct EventDispatcherLibEventPoolConnection {
+	EventDispatcherLibEventPoolListener* listener;
+	evutil_socket_t fd;
+};
+
+class Q_DECL_HIDDEN EventDispatcherLibEventPoolThread : public QThread {
+public:
+	EventDispatcherLibEventPoolThread(int index, int cpu, QSemaphore* started);
+
+	EventDispatcherLibEvent* dispatcher;
+	int index;
+	int cpu;                   ///< CPU to pin the thread to; -1 if the thread is not pinned
+	QAtomicInt connections;
+	QVector<EventDispatcherLibEventPoolListener*> listeners; ///< Accessed only from the thread
+	QVector<EventDispatcherLibEventPoolConnection> accepted; ///< Connections waiting for deliverConnections(); accessed only from the thread
+	QElapsedTimer warned;      ///< Time of the last warning about paused listeners
+	int pauses;                ///< Listener pauses since the last warning
+
+	static void addListener(void* arg);
+	static void deliverConnections(void* arg);
+	static void shutdown(void* arg);
+
+protected:
+	virtual void run(void);
+
+private:
+	QSemaphore* m_started;
+
+	/// How long a listener is paused when the process runs out of descriptors, and how often this is reported (msec)
+	enum {
+		AcceptRetryInterval = 100,
+		WarningInterval     = 10000
+	};
+
+	void pauseListener(EventDispatcherLibEventPoolListener* listener);
+
+	static void accept_callback(evutil_socket_t fd, short int events, void* arg);
+	static void retry_callback(evutil_socket_t fd, short int events, void* arg);
+};
+
+class Q_DECL_HIDDEN EventDispatcherLibEventPoolPrivate {
+public:
+	EventDispatcherLibEventPoolPrivate(EventDispatcherLibEventPool* const q, int size, const EventDispatcherLibEventConfig* config);
+	~EventDispatcherLibEventPoolPrivate(void);
+
+	bool start(void);
+	void stop(void);
+	bool listen(const QByteArray& address, EventDispatcherLibEventPool::AcceptHandler handler, void* context, EventDispatcherLibEventPool::ListenMode mode);
+
+private:
+	Q_DISABLE_COPY(EventDispatcherLibEventPoolPrivate)
+	Q_DECLARE_PUBLIC(EventDispatcherLibEventPool)
+	EventDispatcherLibEventPool* const q_ptr;
+
+	enum State {
+		NotStarted,
+		Running,
+		Stopped
+	};
+
+	State m_state;
+	bool m_affinity;
+	bool m_stealing;
+	QVector<EventDispatcherLibEventPoolThread*> m_threads;
+	QVector<EventDispatcherLibEventPoolListener*> m_listeners;
+	QVector<evutil_socket_t> m_sockets;
+	QSemaphore m_started;
+
+	void postListener(EventDispatcherLibEventPoolListener* listener);
+	static QVector<int> allowedCpus(void);
+	static evutil_socket_t createSocket(const struct sockaddr* addr, int len, bool reuse_port);
+};
+
+#endif // EVENTDISPATCHER_LIBEVENT_POOL_P_H
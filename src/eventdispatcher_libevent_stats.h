@@ -0,0 +1,44 @@
+#ifndef EVENTDISPATCHER_LIBEVENT_STATS_H
+#define EVENTDISPATCHER_LIBEVENT_STATS_H
+
+#include <QtCore/QtGlobal>
+
+/**
+ * @brief Snapshot of the performance counters of an EventDispatcherLibEvent
+ *
+ * Histograms use power-of-two buckets: bucket 0 counts zeroes, bucket @c i counts values
+ * in [2<sup>i-1</sup>, 2<sup>i</sup>); the last bucket also counts everything above.
+ * Times are in microseconds.
+ *
+ * The @c libevent* counters are maintained only if the arena allocator is installed,
+ * see EventDispatcherLibEventConfig::installArenaAllocator(); they are zero otherwise.
+ *
+ * @see EventDispatcherLibEvent::statistics()
+ */
+struct EventDispatcherLibEventStatistics {
+	enum { HistogramSize = 20 };
+
+	quint64 iterations;                        ///< Calls of processEvents()
+	quint64 blockingPolls;                     ///< Polls of the backend which could block
+	quint64 nonBlockingPolls;                  ///< Polls of the backend which could not block, busy polling included
+	quint64 wakeUps;                           ///< Times the dispatcher has been woken up through its descriptor
+	quint64 wakeUpSignals;                     ///< wakeUp() calls which had to signal the descriptor
+	quint64 wakeUpsSuppressed;                 ///< wakeUp() calls which did not have to signal the descriptor
+	int registeredTimers;                      ///< Currently registered timers
+	int registeredNotifiers;                   ///< Currently registered socket notifiers
+	quint64 timerActivations;                  ///< Delivered timer events
+	quint64 readActivations;                   ///< Delivered activations of read notifiers
+	quint64 writeActivations;                  ///< Delivered activations of write notifiers
+	quint64 eventsPerIteration[HistogramSize]; ///< Timer and socket events delivered per iteration
+	quint64 postedEventsTime;                  ///< Time spent in QCoreApplication::sendPostedEvents()
+	quint64 pollTime;                          ///< Time spent in @c event_base_loop(), waiting included
+	quint64 dispatchTime;                      ///< Time spent delivering timer and socket events
+	quint64 timerLateness[HistogramSize];      ///< Delivery time of timer events minus their scheduled expiration time
+	quint64 totalTimerLateness;
+	quint64 maxTimerLateness;
+	quint64 libeventAllocations;               ///< Blocks allocated by libevent for the dispatcher: its event base and the allocations of its thread
+	quint64 libeventFrees;                     ///< Blocks of the dispatcher's arena freed by libevent, by any thread
+	quint64 libeventBytes;                     ///< Bytes allocated from the dispatcher's arena and not yet freed
+};
+
+#endif // EVENTDISPATCHER_LIBEVENT_STATS_H
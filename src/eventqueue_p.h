@@ -0,0 +1,112 @@
+#ifndef EVENTQUEUE_P_H
+#define EVENTQUEUE_P_H
+
+#include <QtCore/QtGlobal>
+#include <QtCore/QObject>
+#include "qt4compat.h"
+
+/**
+ * @internal
+ * @brief Activation waiting to be delivered by processEvents()
+ *
+ * The record does not own an event: processEvents() constructs QTimerEvent or
+ * QEvent(QEvent::SockAct) on the stack at delivery time.
+ */
+struct PendingEvent {
+	QObject* object;           ///< Receiver; 0 if the activation has been cancelled
+	void* source;              ///< TimerInfo or SocketNotifierInfo the activation comes from
+	short int what;            ///< @c EV_TIMEOUT, @c EV_READ or @c EV_WRITE
+};
+
+Q_DECLARE_TYPEINFO(PendingEvent, Q_PRIMITIVE_TYPE);
+
+/**
+ * @internal
+ * @brief Ring buffer of pending activations
+ *
+ * Every record gets a sequence number which stays valid until the record is taken
+ * out of the queue; the owner of the activation remembers it to cancel the record
+ * in O(1) when the notifier or the timer is unregistered. The buffer grows when it
+ * becomes full and never shrinks, so the steady state does not allocate.
+ */
+class Q_DECL_HIDDEN PendingEventQueue {
+public:
+	explicit PendingEventQueue(int capacity = 256)
+		: m_buf(0), m_head(0), m_tail(0), m_mask(0)
+	{
+		int size = 1;
+		while (size < capacity) {
+			size <<= 1;
+		}
+
+		this->m_buf  = new PendingEvent[size];
+		this->m_mask = size - 1;
+	}
+
+	~PendingEventQueue(void)
+	{
+		delete[] this->m_buf;
+	}
+
+	qint64 append(QObject* object, void* source, short int what)
+	{
+		if (Q_UNLIKELY(this->m_tail - this->m_head > this->m_mask)) {
+			this->grow();
+		}
+
+		qint64 seq      = this->m_tail++;
+		PendingEvent& e = this->m_buf[seq & this->m_mask];
+		e.object        = object;
+		e.source        = source;
+		e.what          = what;
+		return seq;
+	}
+
+	PendingEvent takeFirst(void)
+	{
+		Q_ASSERT(!this->isEmpty());
+		return this->m_buf[this->m_head++ & this->m_mask];
+	}
+
+	void cancel(qint64 seq)
+	{
+		if (seq >= this->m_head && seq < this->m_tail) {
+			this->m_buf[seq & this->m_mask].object = 0;
+		}
+	}
+
+	void clear(void)
+	{
+		this->m_head = this->m_tail;
+	}
+
+	bool isEmpty(void) const { return this->m_head == this->m_tail; }
+	int size(void) const { return static_cast<int>(this->m_tail - this->m_head); }
+	qint64 head(void) const { return this->m_head; }
+	qint64 tail(void) const { return this->m_tail; }
+
+private:
+	Q_DISABLE_COPY(PendingEventQueue)
+
+	PendingEvent* m_buf;
+	qint64 m_head;
+	qint64 m_tail;
+	int m_mask;
+
+	void grow(void)
+	{
+		int size          = (this->m_mask + 1) * 2;
+		int mask          = size - 1;
+		PendingEvent* buf = new PendingEvent[size];
+
+		for (qint64 seq=this->m_head; seq<this->m_tail; ++seq) {
+			buf[seq & mask] = this->m_buf[seq & this->m_mask];
+		}
+
+		delete[] this->m_buf;
+		this->m_buf  = buf;
+		this->m_mask = mask;
+	}
+};
+
+#endif // EVENTQUEUE_P_H
@@ -11,6 +11,10 @@
 #include "qt4compat.h"
 
 typedef int evutil_socket_t;
+
+#ifndef EV_ET
+#	define EV_ET 0
+#endif
 typedef void(*event_callback_fn)(evutil_socket_t, short, void*);
 
 Q_DECL_HIDDEN inline struct event* event_new(struct event_base* base, evutil_socket_t fd, short int events, event_callback_fn callback, void* callback_arg)
@@ -26,6 +30,12 @@ Q_DECL_HIDDEN inline void event_free(struct event* e)
 	delete e;
 }
 
+Q_DECL_HIDDEN inline int event_assign(struct event* e, struct event_base* base, evutil_socket_t fd, short int events, event_callback_fn callback, void* callback_arg)
+{
+	event_set(e, fd, events, callback, callback_arg);
+	return event_base_set(base, e);
+}
+
 #ifdef EV_H_
 Q_DECL_HIDDEN inline int event_reinit(struct event_base* base)
 {
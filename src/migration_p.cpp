@@ -0,0 +1,143 @@
+#include "common.h"
+#include "eventdispatcher_libevent.h"
+#include "eventdispatcher_libevent_p.h"
+
+/**
+ * @internal
+ * @brief Socket notifier being migrated and the properties of its descriptor
+ */
+struct MigratedNotifier {
+	QPointer<QSocketNotifier> notifier;
+	bool edge_triggered;
+	int priority;
+};
+
+/**
+ * @internal
+ * @brief State of a migration passed between the source and the target threads
+ */
+struct MigrationInfo {
+	EventDispatcherLibEvent* source;
+	EventDispatcherLibEvent* target;
+	QList<QPointer<QObject> > objects;
+	QList<MigratedNotifier> notifiers;
+	void (*done)(void*);
+	void* context;
+};
+
+static void collectNotifiers(QObject* object, QList<QSocketNotifier*>& notifiers)
+{
+	QSocketNotifier* notifier = qobject_cast<QSocketNotifier*>(object);
+	if (notifier) {
+		notifiers.append(notifier);
+	}
+
+	notifiers += object->findChildren<QSocketNotifier*>();
+}
+
+/**
+ * @brief Moves @a objects to the thread of @a target. Thread-safe
+ * @param objects Objects to move; they must live in this dispatcher's thread and have no parents
+ * @param target Dispatcher to move the objects to
+ * @param done Function to call in @a target's thread when the objects are attached to it; may be 0
+ * @param context Argument for @a done
+ * @return Whether the migration has been started
+ *
+ * Phase one runs in this dispatcher's thread: it records the modes of the descriptors and moves all objects
+ * at once, without returning to the event loop in between, so that none of them is activated halfway.
+ * Qt unregisters their socket notifiers and timers here and queues their registration in the target thread.
+ * Phase two runs in @a target's thread after those queued registrations: it restores the modes of the descriptors
+ * and reports the completion.
+ */
+bool EventDispatcherLibEventPrivate::migrate(const QList<QObject*>& objects, EventDispatcherLibEvent* target, void (*done)(void*), void* context)
+{
+	Q_Q(EventDispatcherLibEvent);
+
+	MigrationInfo* info = new MigrationInfo;
+	info->source        = q;
+	info->target        = target;
+	info->done          = done;
+	info->context       = context;
+
+	for (int i=0; i<objects.size(); ++i) {
+		info->objects.append(objects.at(i));
+	}
+
+	return this->postTask(EventDispatcherLibEventPrivate::migrate_detach, info, EventDispatcherLibEventPrivate::migrate_dispose);
+}
+
+void EventDispatcherLibEventPrivate::migrate_detach(void* arg)
+{
+	MigrationInfo* info                  = static_cast<MigrationInfo*>(arg);
+	EventDispatcherLibEventPrivate* self = info->source->d_func();
+	QThread* thread                      = info->target->thread();
+
+	for (int i=0; i<info->objects.size(); ++i) {
+		QObject* object = info->objects.at(i);
+		if (!object) {
+			continue;
+		}
+
+		if (object->thread() != QThread::currentThread()) {
+			qWarning("%s: object %p does not belong to the source dispatcher's thread", Q_FUNC_INFO, static_cast<void*>(object));
+			continue;
+		}
+
+		QList<QSocketNotifier*> notifiers;
+		collectNotifiers(object, notifiers);
+
+		// moveToThread() unregisters the notifiers: their settings have to be recorded before
+		QList<MigratedNotifier> migrated;
+		for (int j=0; j<notifiers.size(); ++j) {
+			QSocketNotifier* notifier = notifiers.at(j);
+			SocketNotifierInfo* data  = self->findSocketNotifier(notifier->socket());
+
+			MigratedNotifier m;
+			m.notifier       = notifier;
+			m.edge_triggered = data ? data->edge_triggered : self->m_edge_triggered;
+			m.priority       = data ? data->priority : EventDispatcherLibEventPrivate::DefaultPriority;
+			migrated.append(m);
+		}
+
+		object->moveToThread(thread);
+		if (object->thread() != thread) {
+			// E.g. the object has a parent; it stays here together with its notifiers
+			qWarning("%s: object %p could not be moved to the target thread", Q_FUNC_INFO, static_cast<void*>(object));
+			continue;
+		}
+
+		// The parked records keep the settings; a notifier of another socket on the same descriptor resets them
+		info->notifiers += migrated;
+	}
+
+	info->target->d_func()->postTask(EventDispatcherLibEventPrivate::migrate_attach, info, EventDispatcherLibEventPrivate::migrate_dispose);
+}
+
+void EventDispatcherLibEventPrivate::migrate_attach(void* arg)
+{
+	MigrationInfo* info                  = static_cast<MigrationInfo*>(arg);
+	EventDispatcherLibEventPrivate* self = info->target->d_func();
+
+	for (int i=0; i<info->notifiers.size(); ++i) {
+		const MigratedNotifier& m = info->notifiers.at(i);
+		QSocketNotifier* notifier = m.notifier;
+		if (notifier) {
+			// moveToThread() re-enables the notifier with a queued call; make sure it has been delivered.
+			// Re-adding the event makes the backend report the descriptor if it is still ready, so no edge is lost
+			QCoreApplication::sendPostedEvents(notifier, QEvent::MetaCall);
+			self->setEdgeTriggered(notifier->socket(), m.edge_triggered);
+			self->setSocketPriority(notifier->socket(), m.priority);
+		}
+	}
+
+	if (info->done) {
+		info->done(info->context);
+	}
+
+	delete info;
+}
+
+void EventDispatcherLibEventPrivate::migrate_dispose(void* arg)
+{
+	delete static_cast<MigrationInfo*>(arg);
+}
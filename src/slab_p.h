@@ -0,0 +1,72 @@
+#ifndef SLAB_P_H
+#define SLAB_P_H
+
+#include <QtCore/QtGlobal>
+#include <QtCore/QVector>
+#include "qt4compat.h"
+
+/**
+ * @internal
+ * @brief Free list allocator for fixed size records
+ *
+ * Records are carved out of chunks of @a ChunkSize elements; released records
+ * are put onto the free list and reused by subsequent allocations. Memory is
+ * returned to the system only when the allocator is destroyed.
+ *
+ * @a T must be a POD type; the allocator neither constructs nor destroys the records.
+ */
+template<typename T, int ChunkSize = 64>
+class Q_DECL_HIDDEN SlabAllocator {
+public:
+	SlabAllocator(void) : m_free(0), m_chunks() {}
+
+	~SlabAllocator(void)
+	{
+		for (int i=0; i<this->m_chunks.size(); ++i) {
+			delete[] this->m_chunks.at(i);
+		}
+	}
+
+	T* allocate(void)
+	{
+		if (Q_UNLIKELY(!this->m_free)) {
+			this->grow();
+		}
+
+		Node* node   = this->m_free;
+		this->m_free = node->next;
+		return &node->value;
+	}
+
+	void release(T* p)
+	{
+		Node* node   = reinterpret_cast<Node*>(p);
+		node->next   = this->m_free;
+		this->m_free = node;
+	}
+
+private:
+	Q_DISABLE_COPY(SlabAllocator)
+
+	union Node {
+		Node* next;
+		T value;
+	};
+
+	Node* m_free;
+	QVector<Node*> m_chunks;
+
+	void grow(void)
+	{
+		Node* chunk = new Node[ChunkSize];
+		for (int i=0; i<ChunkSize-1; ++i) {
+			chunk[i].next = &chunk[i+1];
+		}
+
+		chunk[ChunkSize-1].next = this->m_free;
+		this->m_free = chunk;
+		this->m_chunks.append(chunk);
+	}
+};
+
+#endif // SLAB_P_H
@@ -1,13 +1,62 @@
 #include "common.h"
 #include "eventdispatcher_libevent_p.h"
+#include "trace_p.h"
+
+SocketNotifierInfo* EventDispatcherLibEventPrivate::findSocketNotifier(evutil_socket_t fd) const
+{
+#ifdef Q_OS_WIN
+	return this->m_notifiers.value(fd);
+#else
+	if (fd >= 0 && fd < this->m_notifiers.size()) {
+		return this->m_notifiers.at(fd);
+	}
+
+	return 0;
+#endif
+}
+
+SocketNotifierInfo* EventDispatcherLibEventPrivate::createSocketNotifier(evutil_socket_t fd)
+{
+	SocketNotifierInfo* data = this->m_notifier_slab.allocate();
+	data->self           = this;
+	data->read           = 0;
+	data->write          = 0;
+	data->last_read      = 0;
+	data->last_write     = 0;
+	data->fd             = fd;
+	data->events         = 0;
+	data->edge_triggered = this->m_edge_triggered;
+	data->priority       = EventDispatcherLibEventPrivate::DefaultPriority;
+	data->suppressed     = -1;
+	data->pending_read   = -1;
+	data->pending_write  = -1;
+	++this->m_parked_notifiers;
+
+#ifdef Q_OS_WIN
+	this->m_notifiers.insert(data->fd, data);
+#else
+	if (data->fd >= this->m_notifiers.size()) {
+		int size = this->m_notifiers.size();
+		this->m_notifiers.resize(data->fd + 1);
+		for (int i=size; i<=data->fd; ++i) {
+			this->m_notifiers[i] = 0;
+		}
+	}
+
+	this->m_notifiers[data->fd] = data;
+#endif
+
+	return data;
+}
 
 void EventDispatcherLibEventPrivate::registerSocketNotifier(QSocketNotifier* notifier)
 {
 	evutil_socket_t sockfd = notifier->socket();
-	short int what;
 	switch (notifier->type()) {
-		case QSocketNotifier::Read:  what = EV_READ; break;
-		case QSocketNotifier::Write: what = EV_WRITE; break;
+		case QSocketNotifier::Read:
+		case QSocketNotifier::Write:
+			break;
+
 		case QSocketNotifier::Exception: /// FIXME
 			return;
 
@@ -16,80 +65,336 @@ void EventDispatcherLibEventPrivate::registerSocketNotifier(QSocketNotifier* not
 			return;
 	}
 
-	what |= EV_PERSIST;
-	struct event* ev = event_new(this->m_base, sockfd, what, EventDispatcherLibEventPrivate::socket_notifier_callback, this);
-	Q_CHECK_PTR(ev);
-	event_add(ev, 0);
+	SocketNotifierInfo* data = this->findSocketNotifier(sockfd);
+	if (!data) {
+		data = this->createSocketNotifier(sockfd);
+	}
+
+	QSocketNotifier*& slot = (QSocketNotifier::Read == notifier->type()) ? data->read : data->write;
+	QSocketNotifier*& last = (QSocketNotifier::Read == notifier->type()) ? data->last_read : data->last_write;
+	if (!data->read && !data->write) {
+		--this->m_parked_notifiers;
 
-	SocketNotifierInfo data;
-	data.sn = notifier;
-	data.ev = ev;
-	this->m_notifiers.insertMulti(sockfd, data);
+		// Settings of a parked record survive notifier toggles, but a notifier other than the last one
+		// means the descriptor has been closed and reused by another socket: it must not inherit them
+		if (last && last != notifier) {
+			data->edge_triggered = this->m_edge_triggered;
+			data->priority       = EventDispatcherLibEventPrivate::DefaultPriority;
+		}
+	}
+
+	if (slot && slot != notifier) {
+		qWarning("%s: Multiple socket notifiers for same socket %d and type %s", Q_FUNC_INFO, static_cast<int>(sockfd), (QSocketNotifier::Read == notifier->type()) ? "Read" : "Write");
+		this->cancelSocketEvent(data, slot);
+	}
+	else if (!slot) {
+		++this->m_stats.registeredNotifiers;
+	}
+
+	slot = notifier;
+	last = notifier;
+	this->updateSocketNotifier(data);
+
+	SJ_TRACE2(notifier_register, sockfd, int(notifier->type()));
 }
 
 void EventDispatcherLibEventPrivate::unregisterSocketNotifier(QSocketNotifier* notifier)
 {
-	evutil_socket_t sockfd = notifier->socket();
-	SocketNotifierHash::Iterator it = this->m_notifiers.find(sockfd);
-	while (it != this->m_notifiers.end() && it.key() == sockfd) {
-		SocketNotifierInfo& data = it.value();
-		if (data.sn == notifier) {
-			event_del(data.ev);
-			event_free(data.ev);
-			it = this->m_notifiers.erase(it);
+	evutil_socket_t sockfd   = notifier->socket();
+	SocketNotifierInfo* data = this->findSocketNotifier(sockfd);
+	if (!data) {
+		return;
+	}
+
+	if (data->read == notifier) {
+		data->read = 0;
+	}
+	else if (data->write == notifier) {
+		data->write = 0;
+	}
+	else {
+		return;
+	}
+
+	SJ_TRACE2(notifier_unregister, sockfd, int(notifier->type()));
+
+	--this->m_stats.registeredNotifiers;
+	this->cancelSocketEvent(data, notifier);
+
+	if (!data->read && !data->write) {
+		if (data->suppressed >= 0) {
+			this->unsuppressSocketNotifier(data);
 		}
-		else {
-			++it;
+	}
+
+	// The record stays in the table even without notifiers: QSocketNotifier::setEnabled()
+	// toggles are frequent, and re-enabling a notifier then costs just an event_add()
+	this->updateSocketNotifier(data);
+
+	if (!data->read && !data->write) {
+		++this->m_parked_notifiers;
+#ifdef Q_OS_WIN
+		// SOCKET handles are not reused as densely as descriptors: bound the table
+		if (this->m_parked_notifiers > EventDispatcherLibEventPrivate::MaxParkedNotifiers) {
+			this->m_notifiers.remove(data->fd);
+			this->m_notifier_slab.release(data);
+			--this->m_parked_notifiers;
 		}
+#endif
 	}
 }
 
-void EventDispatcherLibEventPrivate::socket_notifier_callback(int fd, short int events, void* arg)
+/**
+ * @brief Brings the interest mask of the descriptor's event in line with its notifiers
+ * @param data Descriptor
+ *
+ * Read and write notifiers of the same descriptor share one libevent event;
+ * the event is reassigned only when the set of events to watch changes.
+ */
+void EventDispatcherLibEventPrivate::updateSocketNotifier(SocketNotifierInfo* data)
 {
-	EventDispatcherLibEventPrivate* disp = static_cast<EventDispatcherLibEventPrivate*>(arg);
-	SocketNotifierHash::Iterator it = disp->m_notifiers.find(fd);
-	while (it != disp->m_notifiers.end() && it.key() == fd) {
-		SocketNotifierInfo& data   = it.value();
-		QSocketNotifier::Type type = data.sn->type();
-
-		if ((QSocketNotifier::Read == type && (events & EV_READ)) || (QSocketNotifier::Write == type && (events & EV_WRITE))) {
-			PendingEvent event(data.sn, new QEvent(QEvent::SockAct));
-			disp->m_event_list.append(event);
+	short int events = (data->read ? EV_READ : 0) | (data->write ? EV_WRITE : 0);
+	if (events && data->edge_triggered) {
+		events |= EV_ET;
+	}
+
+	if (events == data->events) {
+		return;
+	}
+
+	if (data->events && data->suppressed < 0) {
+		event_del(&data->ev);
+	}
+
+	data->events = events;
+	if (events) {
+		event_assign(&data->ev, this->m_base, data->fd, events | EV_PERSIST, EventDispatcherLibEventPrivate::socket_notifier_callback, data);
+		event_priority_set(&data->ev, data->priority);
+
+		// A suppressed descriptor is put back into the loop by resumeSocketNotifiers()
+		if (data->suppressed < 0) {
+			event_add(&data->ev, 0);
 		}
+	}
+}
+
+/**
+ * @brief Switches the descriptor @a fd between edge-triggered and level-triggered modes
+ * @param fd Descriptor
+ * @param enable Whether the descriptor should be edge-triggered
+ * @return Whether the mode has been changed
+ *
+ * Every change of the interest mask reassigns and re-adds the event, which makes the backend
+ * re-evaluate the readiness of the descriptor. Thus an edge-triggered notifier which is disabled
+ * and enabled back is activated again if its descriptor is still ready.
+ */
+bool EventDispatcherLibEventPrivate::setEdgeTriggered(evutil_socket_t fd, bool enable)
+{
+#ifndef SJ_LIBEVENT_EMULATION
+	if (enable && !(event_base_get_features(this->m_base) & EV_FEATURE_ET)) {
+		return false;
+	}
+
+	SocketNotifierInfo* data = this->findSocketNotifier(fd);
+	if (!data) {
+		data = this->createSocketNotifier(fd);
+	}
+
+	if (!data->read && !data->write) {
+		// The mode is set up for the next notifier of the descriptor, whichever it is
+		data->last_read  = 0;
+		data->last_write = 0;
+	}
+
+	data->edge_triggered = enable;
+	this->updateSocketNotifier(data);
+	return true;
+#else
+	Q_UNUSED(fd)
+	Q_UNUSED(enable)
+	return false;
+#endif
+}
+
+/**
+ * @brief Assigns the priority class @a priority to the notifiers of the descriptor @a fd
+ * @param fd Descriptor
+ * @param priority Priority class
+ * @return Always @c true
+ *
+ * Pending activations of the notifiers are moved to the queue of the new class.
+ */
+bool EventDispatcherLibEventPrivate::setSocketPriority(evutil_socket_t fd, int priority)
+{
+	SocketNotifierInfo* data = this->findSocketNotifier(fd);
+	if (!data) {
+		data = this->createSocketNotifier(fd);
+	}
+
+	if (!data->read && !data->write) {
+		// The priority class is set up for the next notifier of the descriptor, whichever it is
+		data->last_read  = 0;
+		data->last_write = 0;
+	}
+
+	if (data->priority == priority) {
+		return true;
+	}
+
+	PendingEventQueue& from = this->m_event_queues[data->priority];
+	PendingEventQueue& to   = this->m_event_queues[priority];
+	if (data->pending_read >= 0) {
+		from.cancel(data->pending_read);
+		data->pending_read = to.append(data->read, data, EV_READ);
+	}
 
-		++it;
+	if (data->pending_write >= 0) {
+		from.cancel(data->pending_write);
+		data->pending_write = to.append(data->write, data, EV_WRITE);
 	}
+
+	data->priority = priority;
+	if (data->events) {
+		// Fails only while the event is active; the new class then applies from the next activation
+		event_priority_set(&data->ev, priority);
+	}
+
+	return true;
 }
 
-bool EventDispatcherLibEventPrivate::disableSocketNotifiers(bool disable)
+void EventDispatcherLibEventPrivate::socket_notifier_callback(int fd, short int events, void* arg)
 {
-	SocketNotifierHash::Iterator it = this->m_notifiers.begin();
-	while (it != this->m_notifiers.end()) {
-		SocketNotifierInfo& data = it.value();
-		if (disable) {
-			event_del(data.ev);
-		}
-		else {
-			event_add(data.ev, 0);
+	Q_UNUSED(fd)
+
+	SocketNotifierInfo* data             = static_cast<SocketNotifierInfo*>(arg);
+	EventDispatcherLibEventPrivate* disp = data->self;
+	Q_ASSERT(fd == data->fd);
+
+	SJ_TRACE2(socket_activate, data->fd, int(events));
+
+	if (Q_UNLIKELY(disp->m_exclude_notifiers)) {
+		disp->suppressSocketNotifier(data);
+		return;
+	}
+
+	if ((events & EV_READ) && data->read) {
+		disp->queueSocketEvent(data, EV_READ);
+	}
+
+	if ((events & EV_WRITE) && data->write) {
+		disp->queueSocketEvent(data, EV_WRITE);
+	}
+
+	if (disp->m_dispatch_max && disp->pendingEventCount() >= disp->m_dispatch_max) {
+		// The rest of the ready descriptors stay active in libevent and are collected by the next iteration
+		event_base_loopbreak(disp->m_base);
+	}
+}
+
+/**
+ * @brief Queues the activation of the read or write notifier of the descriptor
+ * @param data Descriptor
+ * @param what @c EV_READ or @c EV_WRITE
+ *
+ * A notifier which has not been delivered its previous activation yet is not queued again.
+ */
+void EventDispatcherLibEventPrivate::queueSocketEvent(SocketNotifierInfo* data, short int what)
+{
+	if (EV_READ == what) {
+		if (data->pending_read < 0) {
+			data->pending_read = this->m_event_queues[data->priority].append(data->read, data, EV_READ);
 		}
+	}
+	else if (data->pending_write < 0) {
+		data->pending_write = this->m_event_queues[data->priority].append(data->write, data, EV_WRITE);
+	}
+}
+
+/**
+ * @brief Drops the pending activation of @a notifier
+ * @param data Descriptor
+ * @param notifier Notifier which is being removed from the descriptor
+ *
+ * This is what protects processEvents() from delivering events to the deleted notifiers.
+ */
+void EventDispatcherLibEventPrivate::cancelSocketEvent(SocketNotifierInfo* data, QSocketNotifier* notifier)
+{
+	qint64& pending = (QSocketNotifier::Read == notifier->type()) ? data->pending_read : data->pending_write;
+	if (pending >= 0) {
+		this->m_event_queues[data->priority].cancel(pending);
+		pending = -1;
+	}
+}
 
-		++it;
+/**
+ * @brief Stops watching the descriptor until resumeSocketNotifiers() is called
+ * @param data Descriptor that became active while socket notifiers were excluded
+ *
+ * Only the descriptors which actually fire are taken out of the event loop;
+ * a level-triggered descriptor would otherwise be reported over and over again.
+ */
+void EventDispatcherLibEventPrivate::suppressSocketNotifier(SocketNotifierInfo* data)
+{
+	if (data->suppressed < 0) {
+		event_del(&data->ev);
+		data->suppressed = this->m_suppressed_notifiers.size();
+		this->m_suppressed_notifiers.append(data);
 	}
+}
+
+void EventDispatcherLibEventPrivate::unsuppressSocketNotifier(SocketNotifierInfo* data)
+{
+	int idx = data->suppressed;
+	Q_ASSERT(idx >= 0 && this->m_suppressed_notifiers.at(idx) == data);
 
+	SocketNotifierInfo* last = this->m_suppressed_notifiers.last();
+	this->m_suppressed_notifiers[idx] = last;
+	last->suppressed = idx;
+	this->m_suppressed_notifiers.removeLast();
+	data->suppressed = -1;
+}
+
+/**
+ * @brief Puts the descriptors suppressed while socket notifiers were excluded back into the event loop
+ * @return Always @c true
+ *
+ * The backend reports the descriptors which are still ready during the next poll.
+ */
+bool EventDispatcherLibEventPrivate::resumeSocketNotifiers(void)
+{
+	for (int i=0; i<this->m_suppressed_notifiers.size(); ++i) {
+		SocketNotifierInfo* data = this->m_suppressed_notifiers.at(i);
+		data->suppressed = -1;
+		if (data->events) {
+			event_add(&data->ev, 0);
+		}
+	}
+
+	this->m_suppressed_notifiers.resize(0); // Keeps the capacity, unlike clear()
 	return true;
 }
 
 void EventDispatcherLibEventPrivate::killSocketNotifiers(void)
 {
 	if (!this->m_notifiers.isEmpty()) {
-		EventDispatcherLibEventPrivate::SocketNotifierHash::Iterator it = this->m_notifiers.begin();
+		EventDispatcherLibEventPrivate::SocketNotifierTable::Iterator it = this->m_notifiers.begin();
 		while (it != this->m_notifiers.end()) {
-			SocketNotifierInfo& data = it.value();
-			event_del(data.ev);
-			event_free(data.ev);
+			SocketNotifierInfo* data = *it;
+			if (data) {
+				if (data->events) {
+					event_del(&data->ev);
+				}
+
+				this->m_notifier_slab.release(data);
+			}
+
 			++it;
 		}
 
 		this->m_notifiers.clear();
+		this->m_suppressed_notifiers.clear();
 	}
+
+	this->m_parked_notifiers          = 0;
+	this->m_stats.registeredNotifiers = 0;
 }
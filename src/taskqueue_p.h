@@ -0,0 +1,174 @@
+#ifndef TASKQUEUE_P_H
+#define TASKQUEUE_P_H
+
+#include <QtCore/QtGlobal>
+#include <QtCore/QMutex>
+#if QT_VERSION >= 0x040400
+#	include <QtCore/QAtomicPointer>
+#endif
+#include "qt4compat.h"
+
+/**
+ * @internal
+ * @brief Task posted to the dispatcher by EventDispatcherLibEvent::postTask()
+ */
+struct TaskNode {
+	TaskNode* next;
+	void (*func)(void*);
+	void (*dispose)(void*);    ///< Called instead of @c func if the task is discarded; may be 0
+	void* context;
+};
+
+/**
+ * @internal
+ * @brief Multiple producer, single consumer queue of tasks
+ *
+ * Producers push tasks onto a lock-free stack with a single compare-and-swap;
+ * the consumer detaches the whole stack at once and restores the FIFO order.
+ */
+class Q_DECL_HIDDEN TaskQueue {
+public:
+	TaskQueue(void) : m_head(0) {}
+
+	/**
+	 * @brief Adds @a node to the queue. Thread-safe
+	 * @param node Task
+	 */
+	void push(TaskNode* node)
+	{
+#if QT_VERSION >= 0x040400
+		TaskNode* head;
+		do {
+#if QT_VERSION >= 0x050000
+			head = this->m_head.load();
+#else
+			head = this->m_head;
+#endif
+			node->next = head;
+		} while (!this->m_head.testAndSetRelease(head, node));
+#else
+		QMutexLocker locker(&this->m_lock);
+		node->next   = this->m_head;
+		this->m_head = node;
+#endif
+	}
+
+	/**
+	 * @brief Takes all tasks out of the queue
+	 * @return Tasks in the order they have been pushed, linked via @c TaskNode::next
+	 */
+	TaskNode* takeAll(void)
+	{
+#if QT_VERSION >= 0x040400
+		TaskNode* node = this->m_head.fetchAndStoreAcquire(0);
+#else
+		QMutexLocker locker(&this->m_lock);
+		TaskNode* node = this->m_head;
+		this->m_head   = 0;
+		locker.unlock();
+#endif
+
+		TaskNode* result = 0;
+		while (node) {
+			TaskNode* next = node->next;
+			node->next     = result;
+			result         = node;
+			node           = next;
+		}
+
+		return result;
+	}
+
+private:
+	Q_DISABLE_COPY(TaskQueue)
+
+#if QT_VERSION >= 0x040400
+	QAtomicPointer<TaskNode> m_head;
+#else
+	TaskNode* m_head;
+	QMutex m_lock;
+#endif
+};
+
+/**
+ * @internal
+ * @brief Free list of task nodes, so that posting a task does not allocate
+ *
+ * Nodes are taken by the posting threads and returned by the dispatcher's thread (or by a peer
+ * which has stolen the task). A lock-free stack would be exposed to the ABA problem with several
+ * threads popping nodes, which cannot be avoided without a double-width compare-and-swap; the lock
+ * is held just for a few instructions and is rarely contended, since the dispatcher returns
+ * the nodes of one iteration at once.
+ */
+class Q_DECL_HIDDEN TaskNodePool {
+public:
+	/// Nodes kept on the free list; the ones beyond are freed
+	enum { MaxFree = 1024 };
+
+	TaskNodePool(void) : m_lock(), m_free(0), m_count(0) {}
+
+	~TaskNodePool(void)
+	{
+		while (this->m_free) {
+			TaskNode* node = this->m_free;
+			this->m_free   = node->next;
+			delete node;
+		}
+	}
+
+	/**
+	 * @brief Takes a node off the free list; allocates one if the list is empty. Thread-safe
+	 */
+	TaskNode* allocate(void)
+	{
+		QMutexLocker locker(&this->m_lock);
+		TaskNode* node = this->m_free;
+		if (node) {
+			this->m_free = node->next;
+			--this->m_count;
+			return node;
+		}
+
+		locker.unlock();
+		return new TaskNode;
+	}
+
+	/**
+	 * @brief Puts the nodes linked via @c TaskNode::next back onto the free list. Thread-safe
+	 * @param first First node
+	 * @param last Last node; its @c next is overwritten
+	 * @param count Number of nodes
+	 */
+	void release(TaskNode* first, TaskNode* last, int count)
+	{
+		QMutexLocker locker(&this->m_lock);
+		if (this->m_count + count <= TaskNodePool::MaxFree) {
+			last->next     = this->m_free;
+			this->m_free   = first;
+			this->m_count += count;
+			return;
+		}
+
+		locker.unlock();
+		last->next = 0;
+		while (first) {
+			TaskNode* node = first;
+			first          = node->next;
+			delete node;
+		}
+	}
+
+	void release(TaskNode* node)
+	{
+		this->release(node, node, 1);
+	}
+
+private:
+	Q_DISABLE_COPY(TaskNodePool)
+
+	QMutex m_lock;
+	TaskNode* m_free;
+	int m_count;
+};
+
+#endif // TASKQUEUE_P_H
@@ -0,0 +1,236 @@
+#include "common.h"
+#include "eventdispatcher_libevent.h"
+#include "eventdispatcher_libevent_p.h"
+
+/**
+ * @brief Queues a task and wakes the dispatcher up. Thread-safe
+ * @param func Function to call in the dispatcher's thread
+ * @param context Argument for @a func
+ * @param dispose Function to call instead of @a func if the dispatcher is destroyed before it runs the task; may be 0
+ * @return Whether the task has been queued
+ */
+bool EventDispatcherLibEventPrivate::postTask(void (*func)(void*), void* context, void (*dispose)(void*))
+{
+	TaskNode* node = this->m_task_nodes.allocate();
+	node->next     = 0;
+	node->func     = func;
+	node->dispose  = dispose;
+	node->context  = context;
+
+	this->m_task_queue.push(node);
+	return this->m_tco->wakeUp();
+}
+
+/**
+ * @brief Moves the posted tasks to the list of tasks to run
+ *
+ * Tasks are not run from libevent callbacks: a task may start a nested event loop.
+ */
+void EventDispatcherLibEventPrivate::takeTasks(void)
+{
+	TaskNode* node = this->m_task_queue.takeAll();
+	if (node) {
+		*this->m_tasks_tail = node;
+		while (node->next) {
+			node = node->next;
+		}
+
+		this->m_tasks_tail = &node->next;
+	}
+}
+
+/**
+ * @brief Runs the posted tasks
+ * @return Whether a task has been run
+ *
+ * Tasks are taken off the list one by one, so that a nested event loop started by a task
+ * continues with the next one.
+ */
+bool EventDispatcherLibEventPrivate::runTasks(void)
+{
+	this->takeTasks();
+
+	// Nodes of the tasks which have been run go back to the free list at once
+	TaskNode* done = 0;
+	TaskNode* last = 0;
+	int count      = 0;
+	while (this->m_tasks) {
+		TaskNode* node = this->m_tasks;
+		this->m_tasks  = node->next;
+		if (!this->m_tasks) {
+			this->m_tasks_tail = &this->m_tasks;
+		}
+
+		void (*func)(void*) = node->func;
+		void* context       = node->context;
+		node->next          = done;
+		done                = node;
+		if (!last) {
+			last = node;
+		}
+
+		++count;
+		func(context);
+	}
+
+	if (done) {
+		this->m_task_nodes.release(done, last, count);
+	}
+
+	return count > 0;
+}
+
+void EventDispatcherLibEventPrivate::discardTasks(void)
+{
+	this->takeTasks();
+
+	while (this->m_tasks) {
+		TaskNode* node = this->m_tasks;
+		this->m_tasks  = node->next;
+		if (node->dispose) {
+			node->dispose(node->context);
+		}
+
+		delete node;
+	}
+
+	this->m_tasks_tail = &this->m_tasks;
+}
+
+/**
+ * @brief Queues a task which any dispatcher of the work stealing group may run. Thread-safe
+ * @param func Function to call
+ * @param context Argument for @a func
+ * @param dispose Function to call instead of @a func if the task is discarded; may be 0
+ * @return Whether the task has been queued
+ *
+ * If this dispatcher already has a backlog of stealable tasks, one of its peers
+ * which is blocked waiting for events is woken up to take a share.
+ */
+bool EventDispatcherLibEventPrivate::postStealableTask(void (*func)(void*), void* context, void (*dispose)(void*))
+{
+	if (!this->m_group) {
+		return this->postTask(func, context, dispose);
+	}
+
+	TaskNode* node = this->m_task_nodes.allocate();
+	node->next     = 0;
+	node->func     = func;
+	node->dispose  = dispose;
+	node->context  = context;
+
+	QMutexLocker locker(&this->m_shared_lock);
+	bool backlog         = (this->m_shared_tasks != 0);
+	*this->m_shared_tail = node;
+	this->m_shared_tail  = &node->next;
+	locker.unlock();
+
+	if (backlog) {
+		QMutexLocker group_locker(&this->m_group->lock);
+		for (int i=0; i<this->m_group->members.size(); ++i) {
+			EventDispatcherLibEventPrivate* peer = this->m_group->members.at(i);
+			if (peer != this && peer->m_tco->isBlocking()) {
+				peer->m_tco->wakeUp();
+				break;
+			}
+		}
+	}
+
+	return this->m_tco->wakeUp();
+}
+
+/**
+ * @brief Makes @a dispatchers share their stealable tasks
+ * @param dispatchers Dispatchers; none of them may be processing events yet
+ */
+void EventDispatcherLibEventPrivate::enableWorkStealing(const QList<EventDispatcherLibEvent*>& dispatchers)
+{
+	WorkStealingGroup* group = new WorkStealingGroup;
+	for (int i=0; i<dispatchers.size(); ++i) {
+		EventDispatcherLibEventPrivate* d = dispatchers.at(i)->d_func();
+		if (d->m_group) {
+			qWarning("%s: the dispatcher already belongs to a work stealing group", Q_FUNC_INFO);
+			continue;
+		}
+
+		d->m_group = group;
+		group->members.append(d);
+	}
+
+	if (group->members.isEmpty()) {
+		delete group;
+	}
+}
+
+TaskNode* EventDispatcherLibEventPrivate::takeSharedTask(void)
+{
+	QMutexLocker locker(&this->m_shared_lock);
+	TaskNode* node = this->m_shared_tasks;
+	if (node) {
+		this->m_shared_tasks = node->next;
+		if (!this->m_shared_tasks) {
+			this->m_shared_tail = &this->m_shared_tasks;
+		}
+	}
+
+	return node;
+}
+
+/**
+ * @brief Runs one stealable task
+ * @param steal Whether to look at the peers' tasks if this dispatcher has none
+ * @return Whether a task has been run
+ */
+bool EventDispatcherLibEventPrivate::runSharedTask(bool steal)
+{
+	TaskNode* node = this->takeSharedTask();
+	if (!node && steal) {
+		QMutexLocker locker(&this->m_group->lock);
+		int size = this->m_group->members.size();
+		int self = this->m_group->members.indexOf(this);
+		for (int i=1; i<size && !node; ++i) {
+			node = this->m_group->members.at((self + i) % size)->takeSharedTask();
+		}
+	}
+
+	if (!node) {
+		return false;
+	}
+
+	void (*func)(void*) = node->func;
+	void* context       = node->context;
+	this->m_task_nodes.release(node);
+
+	func(context);
+	return true;
+}
+
+/**
+ * @brief Removes the dispatcher from its work stealing group and discards its stealable tasks
+ */
+void EventDispatcherLibEventPrivate::leaveWorkStealingGroup(void)
+{
+	if (!this->m_group) {
+		return;
+	}
+
+	QMutexLocker locker(&this->m_group->lock);
+	this->m_group->members.remove(this->m_group->members.indexOf(this));
+	bool last = this->m_group->members.isEmpty();
+	locker.unlock();
+
+	if (last) {
+		delete this->m_group;
+	}
+
+	this->m_group = 0;
+
+	TaskNode* node;
+	while ((node = this->takeSharedTask()) != 0) {
+		if (node->dispose) {
+			node->dispose(node->context);
+		}
+
+		delete node;
+	}
+}
@@ -4,6 +4,9 @@
 #if QT_VERSION >= 0x040600
 #include <QtCore/QScopedPointer>
 #endif
+#if QT_VERSION >= 0x040400
+#include <QtCore/QAtomicInt>
+#endif
 #include "qt4compat.h"
 
 class ThreadCommunicationObjectPrivate;
@@ -16,7 +19,12 @@ public:
 	bool valid(void) const;
 
 	bool wakeUp(void);
-	bool awaken(void);
+	int awaken(void);
+
+	int markRunning(void);
+	bool markBlocking(void);
+	bool isNotified(void) const;
+	bool isBlocking(void) const;
 
 	qintptr fd(void) const;
 private:
@@ -29,6 +37,22 @@ private:
 	ThreadCommunicationObjectPrivate* d_ptr;
 #endif
 
+#if QT_VERSION >= 0x040400
+	enum State {
+		Running,  ///< The owner thread runs handlers and will look for posted events anyway
+		Blocking, ///< The owner thread may block in the event loop; wakeUp() has to signal the descriptor
+		Notified  ///< wakeUp() has been called since the last markRunning()
+	};
+
+	/// The state lives in the low bits; the upper bits count the wake-ups which have not signalled the descriptor
+	enum {
+		StateMask  = 3,
+		CountShift = 2
+	};
+
+	QAtomicInt state;
+#endif
+
 };
 
 #endif // TCO_H
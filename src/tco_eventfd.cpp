@@ -3,10 +3,6 @@
 #include <errno.h>
 #include "tco.h"
 
-#if QT_VERSION >= 0x040400
-#	include <QtCore/QAtomicInt>
-#endif
-
 #if defined(EFD_CLOEXEC) && defined(EFD_NONBLOCK)
 #	define MY_EFD_CLOEXEC EFD_CLOEXEC
 #	define MY_EFD_NONBLOCK EFD_NONBLOCK
@@ -19,9 +15,6 @@ class Q_DECL_HIDDEN ThreadCommunicationObjectPrivate {
 public:
 	ThreadCommunicationObjectPrivate(void)
 		: fd(-1), isvalid(false)
-#if QT_VERSION >= 0x040400
-		  , wakeups()
-#endif
 	{
 		int flags = MY_EFD_CLOEXEC | MY_EFD_NONBLOCK;
 		int res   = ::eventfd(0, flags);
@@ -61,26 +54,21 @@ public:
 	{
 		Q_ASSERT(this->isvalid);
 
-#if QT_VERSION >= 0x040400
-		if (this->wakeups.testAndSetAcquire(0, 1))
-#endif
-		{
-			int res;
-			eventfd_t val = 1;
-			do {
-				res = eventfd_write(this->fd, val);
-			} while (Q_UNLIKELY(res == -1 && errno == EINTR));
-
-			if (Q_UNLIKELY(-1 == res)) {
-				qErrnoWarning("%s: eventfd_write() failed", Q_FUNC_INFO);
-				return false;
-			}
+		int res;
+		eventfd_t val = 1;
+		do {
+			res = eventfd_write(this->fd, val);
+		} while (Q_UNLIKELY(res == -1 && errno == EINTR));
+
+		if (Q_UNLIKELY(-1 == res)) {
+			qErrnoWarning("%s: eventfd_write() failed", Q_FUNC_INFO);
+			return false;
 		}
 
 		return true;
 	}
 
-	bool awaken(void)
+	int awaken(void)
 	{
 		Q_ASSERT(this->isvalid);
 
@@ -92,16 +80,11 @@ public:
 
 		if (Q_UNLIKELY(-1 == res)) {
 			qErrnoWarning("%s: eventfd_read() failed", Q_FUNC_INFO);
+			return -1;
 		}
 
-#if QT_VERSION >= 0x040400
-		if (Q_UNLIKELY(!this->wakeups.testAndSetRelease(1, 0))) {
-			qCritical("%s: internal error, testAndSetRelease(1, 0) failed!", Q_FUNC_INFO);
-			res = -1;
-		}
-#endif
-
-		return res != -1;
+		// Every wakeUp() adds 1 to the counter
+		return static_cast<int>(value);
 	}
 
 	bool valid(void) const { return this->isvalid; }
@@ -110,9 +93,6 @@ public:
 private:
 	int fd;
 	bool isvalid;
-#if QT_VERSION >= 0x040400
-	QAtomicInt wakeups;
-#endif
 
 	int set_cloexec(void)
 	{
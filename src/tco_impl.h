@@ -1,7 +1,11 @@
 #include "tco.h"
+#include "trace_p.h"
 
 ThreadCommunicationObject::ThreadCommunicationObject(void)
 	: d_ptr(new ThreadCommunicationObjectPrivate())
+#if QT_VERSION >= 0x040400
+	  , state(ThreadCommunicationObject::Running)
+#endif
 {
 }
 
@@ -19,18 +23,121 @@ bool ThreadCommunicationObject::valid(void) const
 	return d->valid();
 }
 
+/**
+ * @brief Wakes up the owner thread. Thread-safe
+ * @return Whether the operation succeeded
+ *
+ * The descriptor is signalled only if the owner thread may be blocked in the event loop;
+ * a thread which is busy running handlers checks for posted events before it blocks.
+ */
 bool ThreadCommunicationObject::wakeUp(void)
 {
+#if QT_VERSION >= 0x040400
+	// The event must have been posted before the state changes: markBlocking() fails after this.
+	// A wake-up which does not signal the descriptor is counted in the same word, so that producers
+	// do not contend on a separate counter; the owner thread collects the count in markRunning()
+	int old;
+	int next;
+	do {
+#if QT_VERSION >= 0x050000
+		old = this->state.load();
+#else
+		old = int(this->state);
+#endif
+		if ((old & ThreadCommunicationObject::StateMask) == ThreadCommunicationObject::Blocking) {
+			next = (old & ~ThreadCommunicationObject::StateMask) | ThreadCommunicationObject::Notified;
+		}
+		else {
+			next = int(uint(old) + (1u << ThreadCommunicationObject::CountShift));
+			next = (next & ~ThreadCommunicationObject::StateMask) | ThreadCommunicationObject::Notified;
+		}
+	} while (!this->state.testAndSetOrdered(old, next));
+
+	if ((old & ThreadCommunicationObject::StateMask) != ThreadCommunicationObject::Blocking) {
+		SJ_TRACE2(wake_up, this, 0);
+		return true;
+	}
+#endif
+
+	SJ_TRACE2(wake_up, this, 1);
+
 	Q_D(ThreadCommunicationObject);
 	return d->wakeUp();
 }
 
-bool ThreadCommunicationObject::awaken(void)
+/**
+ * @brief Consumes the signal of the descriptor
+ * @return Number of wakeUp() calls which have signalled the descriptor since the last call
+ * @retval -1 Failure
+ */
+int ThreadCommunicationObject::awaken(void)
 {
+	SJ_TRACE1(awaken, this);
+
 	Q_D(ThreadCommunicationObject);
 	return d->awaken();
 }
 
+/**
+ * @brief Tells the producers that the owner thread is going to look for posted events
+ * @return Number of wakeUp() calls since the last markRunning() which have not signalled the descriptor
+ *
+ * Must be called before the owner thread checks for posted events.
+ */
+int ThreadCommunicationObject::markRunning(void)
+{
+#if QT_VERSION >= 0x040400
+	int old = this->state.fetchAndStoreOrdered(ThreadCommunicationObject::Running);
+	return int(uint(old) >> ThreadCommunicationObject::CountShift);
+#else
+	return 0;
+#endif
+}
+
+/**
+ * @brief Tells the producers that the owner thread is about to block
+ * @return Whether the owner thread may block
+ * @retval false wakeUp() has been called since the last markRunning()
+ */
+bool ThreadCommunicationObject::markBlocking(void)
+{
+#if QT_VERSION >= 0x040400
+	return this->state.testAndSetOrdered(ThreadCommunicationObject::Running, ThreadCommunicationObject::Blocking);
+#else
+	return true;
+#endif
+}
+
+/**
+ * @brief Checks whether wakeUp() has been called since the last markRunning()
+ *
+ * Lets the owner thread notice posted events without touching the descriptor.
+ */
+bool ThreadCommunicationObject::isNotified(void) const
+{
+#if QT_VERSION >= 0x050000
+	return ThreadCommunicationObject::Notified == (this->state.load() & ThreadCommunicationObject::StateMask);
+#elif QT_VERSION >= 0x040400
+	return ThreadCommunicationObject::Notified == (int(this->state) & ThreadCommunicationObject::StateMask);
+#else
+	return false;
+#endif
+}
+
+/**
+ * @brief Checks whether the owner thread may be blocked waiting for events. Thread-safe
+ */
+bool ThreadCommunicationObject::isBlocking(void) const
+{
+#if QT_VERSION >= 0x050000
+	return ThreadCommunicationObject::Blocking == (this->state.load() & ThreadCommunicationObject::StateMask);
+#elif QT_VERSION >= 0x040400
+	return ThreadCommunicationObject::Blocking == (int(this->state) & ThreadCommunicationObject::StateMask);
+#else
+	return false;
+#endif
+}
+
 qintptr ThreadCommunicationObject::fd(void) const
 {
 	Q_D(const ThreadCommunicationObject);
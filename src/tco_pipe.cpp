@@ -2,10 +2,6 @@
 #include <errno.h>
 #include "tco.h"
 
-#if QT_VERSION >= 0x040400
-#	include <QtCore/QAtomicInt>
-#endif
-
 #if defined(Q_OS_LINUX) && defined(O_CLOEXEC)
 #	define THREADSAFE_CLOEXEC_SUPPORTED 1
 namespace libcsupplement {
@@ -21,9 +17,6 @@ class Q_DECL_HIDDEN ThreadCommunicationObjectPrivate {
 public:
 	ThreadCommunicationObjectPrivate(void)
 		: fd(), isvalid(false)
-#if QT_VERSION >= 0x040400
-		  , wakeups()
-#endif
 	{
 		this->fd[0] = -1;
 		this->fd[1] = -1;
@@ -78,49 +71,43 @@ public:
 	{
 		Q_ASSERT(this->isvalid);
 
-#if QT_VERSION >= 0x040400
-		if (this->wakeups.testAndSetAcquire(0, 1))
-#endif
-		{
-			int res;
-			char val = 1;
-			do {
-				res = ::write(this->fd[1], &val, sizeof(val));
-			} while (Q_UNLIKELY(res == -1 && errno == EINTR));
+		int res;
+		char val = 1;
+		do {
+			res = ::write(this->fd[1], &val, sizeof(val));
+		} while (Q_UNLIKELY(res == -1 && errno == EINTR));
 
-			if (Q_UNLIKELY(-1 == res)) {
-				qErrnoWarning("%s: write() failed", Q_FUNC_INFO);
-				return false;
-			}
+		if (Q_UNLIKELY(-1 == res)) {
+			qErrnoWarning("%s: write() failed", Q_FUNC_INFO);
+			return false;
 		}
 
 		return true;
 	}
 
-	bool awaken(void)
+	int awaken(void)
 	{
 		Q_ASSERT(this->isvalid);
 
+		// Every wakeUp() writes one byte
 		char buf[16];
 		int res;
+		int total = 0;
 		do {
 			do {
 				res = ::read(this->fd[0], buf, sizeof(buf));
 			} while (Q_UNLIKELY(-1 == res && EINTR == errno));
+
+			if (res > 0) {
+				total += res;
+			}
 		} while (res == sizeof(buf));
 
 		if (Q_UNLIKELY(-1 == res)) {
 			qErrnoWarning("%s: read() failed", Q_FUNC_INFO);
 		}
 
-#if QT_VERSION >= 0x040400
-		if (Q_UNLIKELY(!this->wakeups.testAndSetRelease(1, 0))) {
-			qCritical("%s: internal error, testAndSetRelease(1, 0) failed!", Q_FUNC_INFO);
-			res = -1;
-		}
-#endif
-
-		return res != -1;
+		return (-1 == res && !total) ? -1 : total;
 	}
 
 	bool valid(void) const { return this->isvalid; }
@@ -129,9 +116,6 @@ public:
 private:
 	int fd[2];
 	bool isvalid;
-#if QT_VERSION >= 0x040400
-	QAtomicInt wakeups;
-#endif
 
 	int set_cloexec(void)
 	{
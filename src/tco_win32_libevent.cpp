@@ -1,16 +1,9 @@
 #include "common.h"
 
-#if QT_VERSION >= 0x040400
-#	include <QtCore/QAtomicInt>
-#endif
-
 class Q_DECL_HIDDEN ThreadCommunicationObjectPrivate {
 public:
 	ThreadCommunicationObjectPrivate(void)
 		: fd(), isvalid(false)
-#if QT_VERSION >= 0x040400
-		  , wakeups()
-#endif
 	{
 		this->fd[0] = INVALID_SOCKET;
 		this->fd[1] = INVALID_SOCKET;
@@ -37,44 +30,37 @@ public:
 	{
 		Q_ASSERT(this->isvalid);
 
-#if QT_VERSION >= 0x040400
-		if (this->wakeups.testAndSetAcquire(0, 1))
-#endif
-		{
-			const char c = '.';
-			int res      = ::send(this->fd[1], &c, 1, 0);
+		const char c = '.';
+		int res      = ::send(this->fd[1], &c, 1, 0);
 
-			if (Q_UNLIKELY(1 != res)) {
-				qWarning("%s: send() failed: %d", Q_FUNC_INFO, WSAGetLastError());
-				return false;
-			}
+		if (Q_UNLIKELY(1 != res)) {
+			qWarning("%s: send() failed: %d", Q_FUNC_INFO, WSAGetLastError());
+			return false;
 		}
 
 		return true;
 	}
 
-	bool awaken(void)
+	int awaken(void)
 	{
 		Q_ASSERT(this->isvalid);
 
+		// Every wakeUp() sends one byte
 		char buf[16];
 		int res;
+		int total = 0;
 		do {
 			res = ::recv(this->fd[0], buf, sizeof(buf), 0);
+			if (res > 0) {
+				total += res;
+			}
 		} while (res == sizeof(buf));
 
 		if (Q_UNLIKELY(SOCKET_ERROR == res)) {
 			qErrnoWarning("%s: recv() failed: %d", Q_FUNC_INFO, WSAGetLastError());
 		}
 
-#if QT_VERSION >= 0x040400
-		if (Q_UNLIKELY(!this->wakeups.testAndSetRelease(1, 0))) {
-			qCritical("%s: internal error, testAndSetRelease(1, 0) failed!", Q_FUNC_INFO);
-			res = -1;
-		}
-#endif
-
-		return res != SOCKET_ERROR;
+		return (SOCKET_ERROR == res && !total) ? -1 : total;
 	}
 
 	bool valid(void) const { return this->isvalid; }
@@ -83,9 +69,6 @@ public:
 private:
 	qintptr fd[2];
 	bool isvalid;
-#if QT_VERSION >= 0x040400
-	QAtomicInt wakeups;
-#endif
 };
 
 #include "tco_impl.h"
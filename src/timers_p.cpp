@@ -1,5 +1,207 @@
 #include "common.h"
 #include "eventdispatcher_libevent_p.h"
+#include "trace_p.h"
+
+#if defined(Q_OS_MAC)
+#	include <mach/mach_time.h>
+#elif !defined(Q_OS_WIN)
+#	include <time.h>
+#endif
+
+/**
+ * @brief Reads the monotonic clock
+ * @param tv Current time; the epoch is unspecified
+ *
+ * Timers must not be affected by NTP steps or manual changes of the system clock,
+ * that is why the timer engine uses the monotonic clock instead of @c evutil_gettimeofday()
+ */
+void EventDispatcherLibEventPrivate::monotonicTime(struct timeval& tv)
+{
+#if defined(Q_OS_WIN)
+	static LARGE_INTEGER freq = { { 0, 0 } };
+	if (Q_UNLIKELY(!freq.QuadPart)) {
+		QueryPerformanceFrequency(&freq);
+	}
+
+	LARGE_INTEGER counter;
+	QueryPerformanceCounter(&counter);
+
+	tv.tv_sec  = static_cast<long int>(counter.QuadPart / freq.QuadPart);
+	tv.tv_usec = static_cast<long int>((counter.QuadPart % freq.QuadPart) * 1000000 / freq.QuadPart);
+#elif defined(Q_OS_MAC)
+	static mach_timebase_info_data_t info = { 0, 0 };
+	if (Q_UNLIKELY(!info.denom)) {
+		mach_timebase_info(&info);
+	}
+
+	quint64 usec = mach_absolute_time() * info.numer / info.denom / 1000;
+	tv.tv_sec  = static_cast<long int>(usec / 1000000);
+	tv.tv_usec = static_cast<long int>(usec % 1000000);
+#elif defined(CLOCK_MONOTONIC)
+	struct timespec ts;
+	if (Q_LIKELY(0 == clock_gettime(CLOCK_MONOTONIC, &ts))) {
+		tv.tv_sec  = ts.tv_sec;
+		tv.tv_usec = ts.tv_nsec / 1000;
+	}
+	else {
+		evutil_gettimeofday(&tv, 0);
+	}
+#else
+	evutil_gettimeofday(&tv, 0);
+#endif
+}
+
+/**
+ * @brief Returns the current time as seen by the timer engine
+ * @return Current monotonic time
+ *
+ * Inside processEvents() the clock is sampled at most once between two delivered events:
+ * the cached value is dropped by invalidateTime() when processEvents() starts, before it polls
+ * for events, after every event handler and when it returns. Thus a burst of timer registrations
+ * costs a single clock read, while a timer re-armed after a long handler starts from the time
+ * the handler returned. Outside the event loop the clock is read on every call.
+ */
+const struct timeval& EventDispatcherLibEventPrivate::currentTime(void) const
+{
+	if (!this->m_now_valid) {
+		this->readClock(this->m_now);
+		this->m_now_valid = (this->m_loop_level > 0);
+	}
+
+	return this->m_now;
+}
+
+void EventDispatcherLibEventPrivate::invalidateTime(void)
+{
+	this->m_now_valid = false;
+}
+
+/**
+ * @brief Reads the clock of the timers, bypassing the cache of currentTime()
+ * @param tv Current time
+ */
+void EventDispatcherLibEventPrivate::readClock(struct timeval& tv) const
+{
+	if (Q_LIKELY(!this->m_clock)) {
+		EventDispatcherLibEventPrivate::monotonicTime(tv);
+	}
+	else {
+		qint64 usec = this->m_clock(this->m_clock_context);
+		tv.tv_sec   = static_cast<long int>(usec / 1000000);
+		tv.tv_usec  = static_cast<long int>(usec % 1000000);
+	}
+}
+
+qint64 EventDispatcherLibEventPrivate::virtual_clock(void* arg)
+{
+	return static_cast<EventDispatcherLibEventPrivate*>(arg)->m_virtual_time;
+}
+
+/**
+ * @brief Replaces the clock of the timers
+ * @param func Clock (usec); 0 restores the monotonic clock
+ * @param context Argument of @a func
+ *
+ * Expiration times computed with the previous clock are meaningless for the new one:
+ * the scheduled timers start over from the current time of @a func.
+ */
+void EventDispatcherLibEventPrivate::setClock(qint64 (*func)(void*), void* context)
+{
+	QVector<TimerInfo*> scheduled;
+	for (int i=0; i<this->m_timers.size(); ++i) {
+		TimerInfo* info = this->m_timers.at(i);
+		if (info && this->isTimerScheduled(info)) {
+			this->cancelTimer(info);
+			scheduled.append(info);
+		}
+	}
+
+	// The wheel is empty now, the first insertion moves its clock to the new time base
+	Q_ASSERT(this->m_wheel.isEmpty());
+	event_del(this->m_wheel_ev);
+	this->m_wheel_armed = -1;
+
+	this->m_clock         = func;
+	this->m_clock_context = context;
+	this->invalidateTime();
+
+	struct timeval now = this->currentTime();
+	for (int i=0; i<this->m_timers.size(); ++i) {
+		TimerInfo* info = this->m_timers.at(i);
+		if (info) {
+			info->when = now;
+		}
+	}
+
+	for (int i=0; i<scheduled.size(); ++i) {
+		this->scheduleTimer(scheduled.at(i), now);
+	}
+}
+
+/**
+ * @brief Switches the timers to the virtual clock
+ * @param start Initial time of the virtual clock (usec)
+ */
+void EventDispatcherLibEventPrivate::setVirtualClock(qint64 start)
+{
+	this->m_virtual_time = start;
+	this->setClock(EventDispatcherLibEventPrivate::virtual_clock, this);
+}
+
+bool EventDispatcherLibEventPrivate::isVirtualClock(void) const
+{
+	return EventDispatcherLibEventPrivate::virtual_clock == this->m_clock;
+}
+
+qint64 EventDispatcherLibEventPrivate::clockTime(void) const
+{
+	struct timeval now;
+	this->readClock(now);
+	return EventDispatcherLibEventPrivate::toUsec(now);
+}
+
+/**
+ * @brief Moves the virtual clock @a usec microseconds forward, delivering the timers which expire on the way
+ * @param usec Time step (usec)
+ * @return Number of delivered events
+ *
+ * The clock jumps from one expiration time to the next one; at every stop the expired timers
+ * are delivered (and rescheduled by their handlers) before the clock moves on. Timers which
+ * become due at the time they were delivered (zero-interval ones) fire again after one virtual
+ * millisecond, the resolution of the wheel. Activations collected earlier are delivered as well,
+ * but the dispatcher neither polls for new ones nor sends posted events.
+ */
+int EventDispatcherLibEventPrivate::advanceClock(qint64 usec)
+{
+	Q_ASSERT(this->isVirtualClock());
+
+	qint64 target = this->m_virtual_time + usec;
+	int delivered = 0;
+
+	for (;;) {
+		for (int i=0; i<EventDispatcherLibEventPrivate::PriorityCount; ++i) {
+			PendingEventQueue& queue = this->m_event_queues[i];
+			while (!queue.isEmpty()) {
+				if (this->deliverEvent(queue.takeFirst())) {
+					++delivered;
+				}
+			}
+		}
+
+		qint64 next = this->m_wheel.nextExpiry();
+		if (-1 == next || next * 1000 > target) {
+			break;
+		}
+
+		this->m_virtual_time = qMax(this->m_virtual_time, next * 1000);
+		this->invalidateTime();
+		this->expireTimers();
+	}
+
+	this->m_virtual_time = target;
+	this->invalidateTime();
+	return delivered;
+}
 
 void EventDispatcherLibEventPrivate::calculateCoarseTimerTimeout(TimerInfo* info, const struct timeval& now, struct timeval& when)
 {
@@ -167,20 +369,201 @@ void EventDispatcherLibEventPrivate::calculateNextTimeout(TimerInfo* info, const
 	evutil_timersub(&when, &now, &delta);
 }
 
+qint64 EventDispatcherLibEventPrivate::toMsec(const struct timeval& tv, bool round_up)
+{
+	return qint64(tv.tv_sec) * 1000 + (tv.tv_usec + (round_up ? 999 : 0)) / 1000;
+}
+
+qint64 EventDispatcherLibEventPrivate::toUsec(const struct timeval& tv)
+{
+	return qint64(tv.tv_sec) * 1000000 + tv.tv_usec;
+}
+
+/**
+ * @return Time from @a from to @a to (usec); negative if @a to is earlier
+ */
+qint64 EventDispatcherLibEventPrivate::elapsed(const struct timeval& from, const struct timeval& to)
+{
+	return (qint64(to.tv_sec) - from.tv_sec) * 1000000 + (to.tv_usec - from.tv_usec);
+}
+
+/**
+ * @return Bucket of a power-of-two histogram @a value falls into
+ * @see EventDispatcherLibEventStatistics
+ */
+int EventDispatcherLibEventPrivate::histogramBucket(quint64 value)
+{
+	int bucket = 0;
+	while (value && bucket < EventDispatcherLibEventStatistics::HistogramSize - 1) {
+		value >>= 1;
+		++bucket;
+	}
+
+	return bucket;
+}
+
+void EventDispatcherLibEventPrivate::scheduleTimer(TimerInfo* info, const struct timeval& now)
+{
+	struct timeval delta;
+	EventDispatcherLibEventPrivate::calculateNextTimeout(info, now, delta);
+
+	struct timeval when;
+	evutil_timeradd(&now, &delta, &when);
+	info->due     = when;
+	info->expires = EventDispatcherLibEventPrivate::toMsec(when, true);
+
+	// With a custom clock the heap of libevent, which runs on its own clock, is of no use
+	if (Qt::PreciseTimer == info->type && !this->m_clock) {
+		event_add(&info->ev, &delta);
+	}
+	else {
+		qint64 msec = EventDispatcherLibEventPrivate::toMsec(now, false);
+		this->m_wheel.insert(info, info->expires, msec);
+		this->armTimerWheel(msec);
+	}
+}
+
+void EventDispatcherLibEventPrivate::cancelTimer(TimerInfo* info)
+{
+	if (info->wheel_slot >= 0) {
+		this->m_wheel.remove(info);
+	}
+	else if (Qt::PreciseTimer == info->type) {
+		event_del(&info->ev);
+	}
+}
+
+bool EventDispatcherLibEventPrivate::isTimerScheduled(TimerInfo* info) const
+{
+	if (info->wheel_slot >= 0) {
+		return true;
+	}
+
+	return Qt::PreciseTimer == info->type && event_pending(&info->ev, EV_TIMEOUT, 0);
+}
+
+/**
+ * @brief Makes sure the wheel event fires not later than the earliest timer in the wheel
+ * @param now Current time, msec
+ *
+ * The wheel event is left as is when it is due earlier than required:
+ * it is cheaper to wake up once for nothing than to reschedule the event on every timer removal.
+ * The virtual clock does not move by itself, the wheel is advanced by advanceClock() instead.
+ */
+void EventDispatcherLibEventPrivate::armTimerWheel(qint64 now)
+{
+	qint64 next = this->m_wheel.nextExpiry();
+	if (-1 == next || this->isVirtualClock() || (this->m_wheel_armed != -1 && this->m_wheel_armed <= next)) {
+		return;
+	}
+
+	qint64 msec = qMax(next - now, qint64(0));
+	struct timeval tv;
+	tv.tv_sec  = static_cast<long int>(msec / 1000);
+	tv.tv_usec = static_cast<long int>((msec % 1000) * 1000);
+
+	event_add(this->m_wheel_ev, &tv);
+	this->m_wheel_armed = next;
+}
+
+/**
+ * @brief Returns the slot of @a timerId in the timer index
+ *
+ * Qt allocates timer ids from a free list and puts a serial number into the upper bits
+ * (@c 0x01000000 and up), so the ids themselves are neither small nor dense. The lower 24 bits
+ * are the index in that list: they are unique among the live timers of the process.
+ */
+int EventDispatcherLibEventPrivate::timerSlot(int timerId)
+{
+	return timerId & 0x00ffffff;
+}
+
+TimerInfo* EventDispatcherLibEventPrivate::findTimer(int timerId) const
+{
+	int slot = EventDispatcherLibEventPrivate::timerSlot(timerId);
+	if (timerId > 0 && slot < this->m_timers.size()) {
+		TimerInfo* info = this->m_timers.at(slot);
+		if (info && info->timerId == timerId) {
+			return info;
+		}
+	}
+
+	return 0;
+}
+
+/**
+ * @brief Unlinks @a info from the list of its object's timers and releases it
+ * @param info Timer
+ */
+void EventDispatcherLibEventPrivate::freeTimer(TimerInfo* info)
+{
+	if (info->object_prev) {
+		info->object_prev->object_next = info->object_next;
+	}
+	else if (info->object_next) {
+		this->m_object_timers[info->object] = info->object_next;
+	}
+	else {
+		this->m_object_timers.remove(info->object);
+	}
+
+	if (info->object_next) {
+		info->object_next->object_prev = info->object_prev;
+	}
+
+	this->releaseTimer(info);
+}
+
+/**
+ * @brief Cancels the timer and returns @a info back to the slab
+ * @param info Timer
+ * @note Does not touch the per-object list of timers
+ */
+void EventDispatcherLibEventPrivate::releaseTimer(TimerInfo* info)
+{
+	if (info->suppressed >= 0) {
+		this->unsuppressTimer(info);
+	}
+
+	if (info->pending >= 0) {
+		this->m_event_queues[info->priority].cancel(info->pending);
+	}
+
+	SJ_TRACE1(timer_unregister, info->timerId);
+
+	this->cancelTimer(info);
+	this->m_timers[EventDispatcherLibEventPrivate::timerSlot(info->timerId)] = 0;
+	--this->m_stats.registeredTimers;
+	this->m_timer_slab.release(info);
+}
+
 void EventDispatcherLibEventPrivate::registerTimer(int timerId, int interval, Qt::TimerType type, QObject* object)
 {
-	struct timeval now;
-	evutil_gettimeofday(&now, 0);
-
-	TimerInfo* info = new TimerInfo;
-	info->self      = this;
-	info->ev        = event_new(this->m_base, -1, 0, EventDispatcherLibEventPrivate::timer_callback, info);
-	info->timerId   = timerId;
-	info->interval  = interval;
-	info->type      = type;
-	info->object    = object;
-	info->when      = now; // calculateNextTimeout() will take care of info->when
-	Q_CHECK_PTR(info->ev);
+	struct timeval now = this->currentTime();
+
+	TimerInfo* info   = this->m_timer_slab.allocate();
+	info->self        = this;
+	info->timerId     = timerId;
+	info->interval    = interval;
+	info->type        = type;
+	info->object      = object;
+	info->when        = now; // calculateNextTimeout() will take care of info->when
+	info->wheel_next  = 0;
+	info->wheel_pprev = 0;
+	info->expires     = 0;
+	info->wheel_slot  = -1;
+	info->object_prev = 0;
+	info->priority    = EventDispatcherLibEventPrivate::DefaultPriority;
+	info->suppressed  = -1;
+	info->pending     = -1;
+
+	TimerInfo*& head  = this->m_object_timers[object];
+	info->object_next = head;
+	if (head) {
+		head->object_prev = info;
+	}
+
+	head = info;
 
 	if (Qt::CoarseTimer == type) {
 		if (interval >= 20000) {
@@ -191,64 +574,94 @@ void EventDispatcherLibEventPrivate::registerTimer(int timerId, int interval, Qt
 		}
 	}
 
-	struct timeval delta;
-	EventDispatcherLibEventPrivate::calculateNextTimeout(info, now, delta);
+	// Coarse timers are managed by the timer wheel, precise ones by libevent's heap
+	if (Qt::PreciseTimer == info->type) {
+		event_assign(&info->ev, this->m_base, -1, 0, EventDispatcherLibEventPrivate::timer_callback, info);
+		event_priority_set(&info->ev, info->priority);
+	}
+
+	int slot = EventDispatcherLibEventPrivate::timerSlot(timerId);
+	if (slot >= this->m_timers.size()) {
+		int size = this->m_timers.size();
+		this->m_timers.resize(slot + 1);
+		for (int i=size; i<=slot; ++i) {
+			this->m_timers[i] = 0;
+		}
+	}
+
+	Q_ASSERT(!this->m_timers.at(slot));
+	this->scheduleTimer(info, now);
+	this->m_timers[slot] = info;
+	++this->m_stats.registeredTimers;
 
-	event_add(info->ev, &delta);
-	this->m_timers.insert(timerId, info);
+	SJ_TRACE3(timer_register, timerId, interval, int(info->type));
 }
 
 bool EventDispatcherLibEventPrivate::unregisterTimer(int timerId)
 {
-	TimerHash::Iterator it = this->m_timers.find(timerId);
-	if (it != this->m_timers.end()) {
-		TimerInfo* info = it.value();
-		event_del(info->ev);
-		event_free(info->ev);
-		delete info;
-		this->m_timers.erase(it);
+	TimerInfo* info = this->findTimer(timerId);
+	if (info) {
+		this->freeTimer(info);
 		return true;
 	}
 
 	return false;
 }
 
-bool EventDispatcherLibEventPrivate::unregisterTimers(QObject* object)
+/**
+ * @brief Assigns the priority class @a priority to the timer @a timerId
+ * @param timerId Timer
+ * @param priority Priority class
+ * @return Whether the timer exists
+ */
+bool EventDispatcherLibEventPrivate::setTimerPriority(int timerId, int priority)
 {
-	TimerHash::Iterator it = this->m_timers.begin();
-	while (it != this->m_timers.end()) {
-		TimerInfo* info = it.value();
-		if (object == info->object) {
-			event_del(info->ev);
-			event_free(info->ev);
-			delete info;
-			it = this->m_timers.erase(it);
+	TimerInfo* info = this->findTimer(timerId);
+	if (!info) {
+		return false;
+	}
+
+	if (info->priority != priority) {
+		if (info->pending >= 0) {
+			this->m_event_queues[info->priority].cancel(info->pending);
+			info->pending = this->m_event_queues[priority].append(info->object, info, EV_TIMEOUT);
 		}
-		else {
-			++it;
+
+		info->priority = priority;
+		if (Qt::PreciseTimer == info->type) {
+			// Fails only while the event is active; the new class then applies from the next activation
+			event_priority_set(&info->ev, priority);
 		}
 	}
 
 	return true;
 }
 
+bool EventDispatcherLibEventPrivate::unregisterTimers(QObject* object)
+{
+	TimerInfo* info = this->m_object_timers.take(object);
+	while (info) {
+		TimerInfo* next = info->object_next;
+		this->releaseTimer(info);
+		info = next;
+	}
+
+	return true;
+}
+
 QList<QAbstractEventDispatcher::TimerInfo> EventDispatcherLibEventPrivate::registeredTimers(QObject* object) const
 {
 	QList<QAbstractEventDispatcher::TimerInfo> res;
 
-	TimerHash::ConstIterator it = this->m_timers.constBegin();
-	while (it != this->m_timers.constEnd()) {
-		TimerInfo* info = it.value();
-		if (object == info->object) {
+	const TimerInfo* info = this->m_object_timers.value(object);
+	while (info) {
 #if QT_VERSION < 0x050000
-			QAbstractEventDispatcher::TimerInfo ti(it.key(), info->interval);
+		QAbstractEventDispatcher::TimerInfo ti(info->timerId, info->interval);
 #else
-			QAbstractEventDispatcher::TimerInfo ti(it.key(), info->interval, info->type);
+		QAbstractEventDispatcher::TimerInfo ti(info->timerId, info->interval, info->type);
 #endif
-			res.append(ti);
-		}
-
-		++it;
+		res.append(ti);
+		info = info->object_next;
 	}
 
 	return res;
@@ -256,28 +669,33 @@ QList<QAbstractEventDispatcher::TimerInfo> EventDispatcherLibEventPrivate::regis
 
 int EventDispatcherLibEventPrivate::remainingTime(int timerId) const
 {
-	TimerHash::ConstIterator it = this->m_timers.find(timerId);
-	if (it != this->m_timers.end()) {
-		const TimerInfo* info = it.value();
-		struct timeval when;
-
-		int r = event_pending(info->ev, EV_TIMEOUT, &when);
-		if (r) {
-			struct timeval now;
-			evutil_gettimeofday(&now, 0);
+	TimerInfo* info = this->findTimer(timerId);
+	if (info && this->isTimerScheduled(info)) {
+		// Not worth caching: the answer must not depend on how long the caller's handler has been running
+		struct timeval now;
+		this->readClock(now);
+		qint64 msec = info->expires - EventDispatcherLibEventPrivate::toMsec(now, false);
+		return static_cast<int>(qMax(msec, qint64(0)));
+	}
 
-			qulonglong tnow  = qulonglong(now.tv_sec)  * 1000000 + now.tv_usec;
-			qulonglong twhen = qulonglong(when.tv_sec) * 1000000 + when.tv_usec;
+	return -1;
+}
 
-			if (tnow > twhen) {
-				return 0;
-			}
+void EventDispatcherLibEventPrivate::queueTimerEvent(TimerInfo* info)
+{
+	if (Q_UNLIKELY(this->m_exclude_timers)) {
+		// X11ExcludeTimers: the timer stays unscheduled until resumeTimers() delivers it
+		info->suppressed = this->m_suppressed_timers.size();
+		this->m_suppressed_timers.append(info);
+		return;
+	}
 
-			return static_cast<int>((twhen - tnow) / 1000);
-		}
+	// Reading the time may cost a clock call: not without a tracer
+	if (Q_UNLIKELY(SJ_TRACE_ENABLED(timer_fire))) {
+		SJ_TRACE4(timer_fire, info->timerId, EventDispatcherLibEventPrivate::toUsec(info->due), EventDispatcherLibEventPrivate::toUsec(this->currentTime()), int(info->type));
 	}
 
-	return -1;
+	info->pending = this->m_event_queues[info->priority].append(info->object, info, EV_TIMEOUT);
 }
 
 void EventDispatcherLibEventPrivate::timer_callback(int fd, short int events, void* arg)
@@ -290,47 +708,78 @@ void EventDispatcherLibEventPrivate::timer_callback(int fd, short int events, vo
 	TimerInfo* info = static_cast<TimerInfo*>(arg);
 
 	// Timer can be reactivated only after its callback finishes; processEvents() will take care of this
-	PendingEvent event(info->object, new QTimerEvent(info->timerId));
-	info->self->m_event_list.append(event);
+	info->self->queueTimerEvent(info);
 }
 
-bool EventDispatcherLibEventPrivate::disableTimers(bool disable)
+void EventDispatcherLibEventPrivate::wheel_callback(int fd, short int events, void* arg)
 {
-	struct timeval now;
-	if (!disable) {
-		evutil_gettimeofday(&now, 0);
+	Q_ASSERT(-1 == fd);
+	Q_ASSERT(events & EV_TIMEOUT);
+	Q_UNUSED(fd)
+	Q_UNUSED(events)
+
+	EventDispatcherLibEventPrivate* disp = static_cast<EventDispatcherLibEventPrivate*>(arg);
+	disp->m_wheel_armed = -1;
+	disp->expireTimers();
+}
+
+/**
+ * @brief Advances the wheel to the current time and queues the events of the expired timers
+ */
+void EventDispatcherLibEventPrivate::expireTimers(void)
+{
+	qint64 msec     = EventDispatcherLibEventPrivate::toMsec(this->currentTime(), false);
+	TimerInfo* info = this->m_wheel.advance(msec);
+	while (info) {
+		TimerInfo* next  = info->wheel_next;
+		info->wheel_next = 0;
+
+		// Just like timer_callback(): the timer is rescheduled by processEvents() after its handler finishes
+		this->queueTimerEvent(info);
+		info = next;
 	}
 
-	TimerHash::Iterator it = this->m_timers.begin();
-	while (it != this->m_timers.end()) {
-		TimerInfo* info = it.value();
-		if (disable) {
-			event_del(info->ev);
-		}
-		else {
-			struct timeval delta;
-			EventDispatcherLibEventPrivate::calculateNextTimeout(info, now, delta);
-			event_add(info->ev, &delta);
-		}
+	this->armTimerWheel(msec);
+}
 
-		++it;
+void EventDispatcherLibEventPrivate::unsuppressTimer(TimerInfo* info)
+{
+	int idx = info->suppressed;
+	Q_ASSERT(idx >= 0 && this->m_suppressed_timers.at(idx) == info);
+
+	TimerInfo* last = this->m_suppressed_timers.last();
+	this->m_suppressed_timers[idx] = last;
+	last->suppressed = idx;
+	this->m_suppressed_timers.removeLast();
+	info->suppressed = -1;
+}
+
+/**
+ * @brief Delivers the timers which expired while timers were excluded
+ * @return Always @c true
+ */
+bool EventDispatcherLibEventPrivate::resumeTimers(void)
+{
+	for (int i=0; i<this->m_suppressed_timers.size(); ++i) {
+		TimerInfo* info  = this->m_suppressed_timers.at(i);
+		info->suppressed = -1;
+		this->queueTimerEvent(info);
 	}
 
+	this->m_suppressed_timers.resize(0); // Keeps the capacity, unlike clear()
 	return true;
 }
 
 void EventDispatcherLibEventPrivate::killTimers(void)
 {
-	if (!this->m_timers.isEmpty()) {
-		TimerHash::Iterator it = this->m_timers.begin();
-		while (it != this->m_timers.end()) {
-			TimerInfo* info = it.value();
-			event_del(info->ev);
-			event_free(info->ev);
-			delete info;
-			++it;
+	for (int i=0; i<this->m_timers.size(); ++i) {
+		TimerInfo* info = this->m_timers.at(i);
+		if (info) {
+			this->releaseTimer(info);
 		}
-
-		this->m_timers.clear();
 	}
+
+	this->m_timers.clear();
+	this->m_object_timers.clear();
+	this->m_wheel.clear();
 }
@@ -0,0 +1,250 @@
+#include "common.h"
+#include "eventdispatcher_libevent_p.h"
+#include "timerwheel_p.h"
+
+#if defined(_MSC_VER) && defined(_WIN64)
+#	include <intrin.h>
+#endif
+
+/**
+ * @internal
+ * @brief Returns the index of the least significant set bit of @a v
+ * @param v Value, must not be zero
+ */
+static inline int lowestBit(quint64 v)
+{
+	Q_ASSERT(v != 0);
+#if defined(Q_CC_GNU) || defined(Q_CC_CLANG)
+	return __builtin_ctzll(v);
+#elif defined(_MSC_VER) && defined(_WIN64)
+	unsigned long idx;
+	_BitScanForward64(&idx, v);
+	return static_cast<int>(idx);
+#else
+	int idx = 0;
+	while (!(v & 1)) {
+		v >>= 1;
+		++idx;
+	}
+
+	return idx;
+#endif
+}
+
+TimerWheel::TimerWheel(void)
+	: m_clk(0), m_count(0)
+{
+	this->clear();
+}
+
+void TimerWheel::clear(void)
+{
+	for (int level=0; level<TimerWheel::Levels; ++level) {
+		this->m_bitmap[level] = 0;
+		for (int slot=0; slot<TimerWheel::Slots; ++slot) {
+			this->m_slots[level][slot] = 0;
+		}
+	}
+
+	this->m_count = 0;
+}
+
+/**
+ * @brief Adds @a info to the wheel
+ * @param info Timer
+ * @param expires Expiration time (msec)
+ * @param now Current time (msec)
+ */
+void TimerWheel::insert(TimerInfo* info, qint64 expires, qint64 now)
+{
+	Q_ASSERT(info->wheel_slot < 0);
+
+	if (!this->m_count) {
+		// Nothing to cascade, it is safe to jump to the current time
+		this->m_clk = now;
+	}
+
+	info->expires = expires;
+	this->link(info);
+	++this->m_count;
+}
+
+/**
+ * @brief Removes @a info from the wheel
+ * @param info Timer
+ */
+void TimerWheel::remove(TimerInfo* info)
+{
+	Q_ASSERT(info->wheel_slot >= 0);
+
+	if (info->wheel_next) {
+		info->wheel_next->wheel_pprev = info->wheel_pprev;
+	}
+
+	*info->wheel_pprev = info->wheel_next;
+
+	int level = info->wheel_slot >> TimerWheel::Bits;
+	int slot  = info->wheel_slot &  TimerWheel::Mask;
+	if (!this->m_slots[level][slot]) {
+		this->m_bitmap[level] &= ~(Q_UINT64_C(1) << slot);
+	}
+
+	info->wheel_next  = 0;
+	info->wheel_pprev = 0;
+	info->wheel_slot  = -1;
+	--this->m_count;
+}
+
+/**
+ * @brief Advances the wheel clock up to @a now (inclusive)
+ * @param now Current time (msec)
+ * @return List of the expired timers linked via @c TimerInfo::wheel_next; the timers are removed from the wheel
+ */
+TimerInfo* TimerWheel::advance(qint64 now)
+{
+	TimerInfo* expired = 0;
+	TimerInfo** tail   = &expired;
+
+	while (this->m_clk <= now) {
+		if (!this->m_count) {
+			this->m_clk = now + 1;
+			break;
+		}
+
+		int idx = static_cast<int>(this->m_clk & TimerWheel::Mask);
+		if (!idx) {
+			this->cascade(1);
+		}
+
+		TimerInfo* info = this->m_slots[0][idx];
+		if (info) {
+			this->m_slots[0][idx] = 0;
+			this->m_bitmap[0]    &= ~(Q_UINT64_C(1) << idx);
+
+			*tail = info;
+			while (info) {
+				info->wheel_slot = -1;
+				--this->m_count;
+				tail = &info->wheel_next;
+				info = info->wheel_next;
+			}
+		}
+
+		++this->m_clk;
+
+		// Skip the ticks without timers, but never jump over a cascade boundary
+		qint64 next = (this->m_clk | TimerWheel::Mask) + 1;
+		idx         = static_cast<int>(this->m_clk & TimerWheel::Mask);
+		if (idx) {
+			quint64 pending = this->m_bitmap[0] & (~Q_UINT64_C(0) << idx);
+			if (pending) {
+				next = (this->m_clk & ~qint64(TimerWheel::Mask)) + lowestBit(pending);
+			}
+
+			this->m_clk = qMin(next, now + 1);
+		}
+	}
+
+	for (TimerInfo* info = expired; info; info = info->wheel_next) {
+		info->wheel_pprev = 0;
+	}
+
+	return expired;
+}
+
+/**
+ * @brief Returns the earliest time when the wheel needs to be advanced
+ * @return Time (msec)
+ * @retval -1 The wheel is empty
+ */
+qint64 TimerWheel::nextExpiry(void) const
+{
+	if (!this->m_count) {
+		return -1;
+	}
+
+	qint64 result = -1;
+	for (int level=0; level<TimerWheel::Levels; ++level) {
+		quint64 bitmap = this->m_bitmap[level];
+		if (!bitmap) {
+			continue;
+		}
+
+		// The first tick not before m_clk where slots of this level are processed
+		int shift    = level * TimerWheel::Bits;
+		qint64 gran  = qint64(1) << shift;
+		qint64 start = (this->m_clk + gran - 1) & ~(gran - 1);
+		int pos      = static_cast<int>((start >> shift) & TimerWheel::Mask);
+
+		quint64 rotated = pos ? ((bitmap >> pos) | (bitmap << (TimerWheel::Slots - pos))) : bitmap;
+		qint64 when     = start + (qint64(lowestBit(rotated)) << shift);
+
+		if (-1 == result || when < result) {
+			result = when;
+		}
+	}
+
+	return result;
+}
+
+void TimerWheel::link(TimerInfo* info)
+{
+	qint64 expires = qMax(info->expires, this->m_clk);
+	qint64 delta   = expires - this->m_clk;
+
+	int level = 0;
+	while (level < TimerWheel::Levels - 1 && delta >= (qint64(1) << ((level + 1) * TimerWheel::Bits))) {
+		++level;
+	}
+
+	if (level == TimerWheel::Levels - 1) {
+		qint64 max = (qint64(1) << (TimerWheel::Levels * TimerWheel::Bits)) - 1;
+		if (delta > max) {
+			expires = this->m_clk + max;
+		}
+	}
+
+	int slot = static_cast<int>((expires >> (level * TimerWheel::Bits)) & TimerWheel::Mask);
+	TimerInfo** head = &this->m_slots[level][slot];
+
+	info->wheel_next  = *head;
+	info->wheel_pprev = head;
+	info->wheel_slot  = (level << TimerWheel::Bits) | slot;
+	if (*head) {
+		(*head)->wheel_pprev = &info->wheel_next;
+	}
+
+	*head = info;
+	this->m_bitmap[level] |= Q_UINT64_C(1) << slot;
+}
+
+/**
+ * @brief Redistributes the current slot of @a level into the lower levels
+ * @param level Level to cascade
+ *
+ * Called when the clock reaches a boundary of level @a level - 1;
+ * if the clock is at the boundary of @a level as well, the upper level is cascaded next.
+ */
+void TimerWheel::cascade(int level)
+{
+	while (level < TimerWheel::Levels) {
+		int shift = level * TimerWheel::Bits;
+		int idx   = static_cast<int>((this->m_clk >> shift) & TimerWheel::Mask);
+
+		TimerInfo* info = this->m_slots[level][idx];
+		this->m_slots[level][idx] = 0;
+		this->m_bitmap[level]    &= ~(Q_UINT64_C(1) << idx);
+
+		while (info) {
+			TimerInfo* next = info->wheel_next;
+			this->link(info);
+			info = next;
+		}
+
+		if (idx) {
+			break;
+		}
+
+		++level;
+	}
+}
@@ -0,0 +1,53 @@
+#ifndef TIMERWHEEL_P_H
+#define TIMERWHEEL_P_H
+
+#include <QtCore/QtGlobal>
+#include "qt4compat.h"
+
+struct TimerInfo;
+
+/**
+ * @internal
+ * @brief Hierarchical timing wheel for coarse timers
+ *
+ * The wheel consists of @c TimerWheel::Levels levels of @c TimerWheel::Slots slots each.
+ * Level @c k has a granularity of <tt>Slots^k</tt> milliseconds; timers are linked into
+ * the slots intrusively (via @c TimerInfo::wheel_next and @c TimerInfo::wheel_pprev),
+ * so that insertion and removal are O(1). When the clock crosses a level boundary,
+ * the corresponding slot of the upper level is cascaded into the lower levels.
+ *
+ * All times are expressed in milliseconds.
+ */
+class Q_DECL_HIDDEN TimerWheel {
+public:
+	TimerWheel(void);
+
+	void insert(TimerInfo* info, qint64 expires, qint64 now);
+	void remove(TimerInfo* info);
+	TimerInfo* advance(qint64 now);
+	qint64 nextExpiry(void) const;
+	void clear(void);
+
+	bool isEmpty(void) const { return 0 == this->m_count; }
+	int count(void) const { return this->m_count; }
+
+	enum {
+		Bits   = 6,
+		Slots  = 1 << Bits,
+		Mask   = Slots - 1,
+		Levels = 6
+	};
+
+private:
+	Q_DISABLE_COPY(TimerWheel)
+
+	TimerInfo* m_slots[Levels][Slots];
+	quint64 m_bitmap[Levels];
+	qint64 m_clk;
+	int m_count;
+
+	void link(TimerInfo* info);
+	void cascade(int level);
+};
+
+#endif // TIMERWHEEL_P_H
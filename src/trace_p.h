@@ -0,0 +1,58 @@
+#ifndef TRACE_P_H
+#define TRACE_P_H
+
+/*
+ * Static (USDT) tracepoints of the dispatcher, provider "eventdispatcher_libevent".
+ *
+ * A disabled probe is a single NOP instruction; the arguments are still evaluated,
+ * so they must stay cheap. Arguments which are not should be computed under
+ * SJ_TRACE_ENABLED(name), which tests the probe's semaphore: tracers increment it
+ * while they are attached. Define SJ_NO_TRACEPOINTS to compile the probes out.
+ * See tools/bpftrace for examples.
+ */
+
+#if !defined(SJ_NO_TRACEPOINTS) && defined(__has_include)
+#	if __has_include(<sys/sdt.h>)
+#		define _SDT_HAS_SEMAPHORES 1
+#		include <sys/sdt.h>
+#		define SJ_HAVE_TRACEPOINTS
+#	endif
+#endif
+
+#ifdef SJ_HAVE_TRACEPOINTS
+/*
+ * With semaphores, every probe needs one. They are defined by SJ_DEFINE_TRACE_SEMAPHORES
+ * in eventdispatcher_libevent_p.cpp
+ */
+#	define SJ_TRACE_PROBES(X)                           \
+		X(process_events_enter) X(process_events_exit) \
+		X(block_enter)          X(block_exit)          \
+		X(posted_events_enter)  X(posted_events_exit)  \
+		X(timer_fire)           X(socket_activate)     \
+		X(wake_up)              X(awaken)              \
+		X(timer_register)       X(timer_unregister)    \
+		X(notifier_register)    X(notifier_unregister)
+
+#	define SJ_DECLARE_TRACE_SEMAPHORE(name) extern "C" volatile unsigned short eventdispatcher_libevent_##name##_semaphore;
+#	define SJ_DEFINE_TRACE_SEMAPHORE(name)  extern "C" { __attribute__((section(".probes"))) volatile unsigned short eventdispatcher_libevent_##name##_semaphore = 0; }
+#	define SJ_DEFINE_TRACE_SEMAPHORES       SJ_TRACE_PROBES(SJ_DEFINE_TRACE_SEMAPHORE)
+
+SJ_TRACE_PROBES(SJ_DECLARE_TRACE_SEMAPHORE)
+
+#	define SJ_TRACE_ENABLED(name)           (eventdispatcher_libevent_##name##_semaphore != 0)
+#	define SJ_TRACE0(name)             DTRACE_PROBE(eventdispatcher_libevent, name)
+#	define SJ_TRACE1(name, a)          DTRACE_PROBE1(eventdispatcher_libevent, name, a)
+#	define SJ_TRACE2(name, a, b)       DTRACE_PROBE2(eventdispatcher_libevent, name, a, b)
+#	define SJ_TRACE3(name, a, b, c)    DTRACE_PROBE3(eventdispatcher_libevent, name, a, b, c)
+#	define SJ_TRACE4(name, a, b, c, d) DTRACE_PROBE4(eventdispatcher_libevent, name, a, b, c, d)
+#else
+#	define SJ_DEFINE_TRACE_SEMAPHORES
+#	define SJ_TRACE_ENABLED(name)      false
+#	define SJ_TRACE0(name)             do {} while (0)
+#	define SJ_TRACE1(name, a)          do {} while (0)
+#	define SJ_TRACE2(name, a, b)       do {} while (0)
+#	define SJ_TRACE3(name, a, b, c)    do {} while (0)
+#	define SJ_TRACE4(name, a, b, c, d) do {} while (0)
+#endif
+
+#endif // TRACE_P_H
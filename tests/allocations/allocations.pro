@@ -0,0 +1,11 @@
+QT      -= gui
+QT      += testlib
+CONFIG  += console testcase
+CONFIG  -= app_bundle
+TARGET   = tst_allocations
+DESTDIR  = ..
+
+HEADERS  = allochooks.h
+SOURCES  = tst_allocations.cpp allochooks.c
+
+include(../local.pri)
@@ -0,0 +1,116 @@
+#include <limits.h> /* defines __GLIBC__ */
+#include <stddef.h>
+#include "allochooks.h"
+
+#if defined(__GLIBC__) && !defined(__SANITIZE_ADDRESS__)
+
+#include <errno.h>
+#include <pthread.h>
+
+extern void* __libc_malloc(size_t size);
+extern void* __libc_calloc(size_t nmemb, size_t size);
+extern void* __libc_realloc(void* ptr, size_t size);
+extern void* __libc_memalign(size_t alignment, size_t size);
+extern void* __libc_valloc(size_t size);
+
+static volatile int counting = 0;
+static pthread_t counted_thread;
+static volatile long int allocations = 0;
+
+static void count(void)
+{
+	if (counting && pthread_equal(counted_thread, pthread_self())) {
+		++allocations;
+	}
+}
+
+void* malloc(size_t size)
+{
+	count();
+	return __libc_malloc(size);
+}
+
+void* calloc(size_t nmemb, size_t size)
+{
+	count();
+	return __libc_calloc(nmemb, size);
+}
+
+void* realloc(void* ptr, size_t size)
+{
+	count();
+	return __libc_realloc(ptr, size);
+}
+
+int posix_memalign(void** memptr, size_t alignment, size_t size)
+{
+	void* ptr;
+
+	/* The checks of glibc's posix_memalign(), which __libc_memalign() does not make */
+	if (!alignment || (alignment & (alignment - 1)) || (alignment % sizeof(void*))) {
+		return EINVAL;
+	}
+
+	count();
+	ptr = __libc_memalign(alignment, size);
+	if (!ptr) {
+		return ENOMEM;
+	}
+
+	*memptr = ptr;
+	return 0;
+}
+
+void* aligned_alloc(size_t alignment, size_t size)
+{
+	count();
+	return __libc_memalign(alignment, size);
+}
+
+void* memalign(size_t alignment, size_t size)
+{
+	count();
+	return __libc_memalign(alignment, size);
+}
+
+void* valloc(size_t size)
+{
+	count();
+	return __libc_valloc(size);
+}
+
+int allocHooksAvailable(void)
+{
+	return 1;
+}
+
+void allocHooksStart(void)
+{
+	counted_thread = pthread_self();
+	allocations    = 0;
+	counting       = 1;
+}
+
+long int allocHooksStop(void)
+{
+	counting = 0;
+	return allocations;
+}
+
+#else
+
+int allocHooksAvailable(void)
+{
+	return 0;
+}
+
+void allocHooksStart(void)
+{
+}
+
+long int allocHooksStop(void)
+{
+	return 0;
+}
+
+#endif
@@ -0,0 +1,30 @@
+#ifndef ALLOCHOOKS_H
+#define ALLOCHOOKS_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Counters of heap allocations made by one thread.
+ *
+ * With glibc, malloc(), calloc(), realloc() and the aligned allocators (posix_memalign(),
+ * aligned_alloc(), memalign(), valloc()) defined in the executable
+ * take precedence over the ones in libc for every library in the process (libevent, Qt,
+ * operator new); they count the calls and forward them to glibc.
+ */
+
+/* Whether the allocations can be counted on this platform */
+int allocHooksAvailable(void);
+
+/* Starts counting the allocations made by the calling thread */
+void allocHooksStart(void);
+
+/* Stops counting; returns the number of allocations since allocHooksStart() */
+long int allocHooksStop(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* ALLOCHOOKS_H */
@@ -0,0 +1,194 @@
+#include <QtCore/QCoreApplication>
+#include <QtCore/QElapsedTimer>
+#include <QtCore/QEventLoop>
+#include <QtCore/QSocketNotifier>
+#include <QtCore/QVector>
+#include <QtTest/QtTest>
+#include "eventdispatcher_libevent.h"
+#include "allochooks.h"
+
+#ifndef Q_OS_WIN
+#	include <sys/socket.h>
+#	include <unistd.h>
+#endif
+
+class Reader : public QObject {
+	Q_OBJECT
+public:
+	Reader(void) : QObject(), received(0) {}
+
+	int received;
+
+public Q_SLOTS:
+	void activated(int fd)
+	{
+		char buf[16];
+		if (::recv(fd, buf, sizeof(buf), 0) > 0) {
+			++this->received;
+		}
+	}
+};
+
+class TimerCounter : public QObject {
+public:
+	TimerCounter(void) : QObject(), fired(0) {}
+
+	int fired;
+
+protected:
+	virtual void timerEvent(QTimerEvent*)
+	{
+		++this->fired;
+	}
+};
+
+class tst_Allocations : public QObject {
+	Q_OBJECT
+private Q_SLOTS:
+	void initTestCase(void);
+	void steadyState_data(void);
+	void steadyState(void);
+	void cleanup(void);
+
+private:
+	QVector<int> m_fds;
+	QVector<QSocketNotifier*> m_notifiers;
+
+	long int iterate(bool count, QEventLoop::ProcessEventsFlags flags);
+};
+
+void tst_Allocations::initTestCase(void)
+{
+	// Only glibc builds have the hooks; Windows has no socket pairs either
+	if (!allocHooksAvailable()) {
+#if QT_VERSION >= 0x050000
+		QSKIP("Allocations cannot be counted on this platform");
+#else
+		QSKIP("Allocations cannot be counted on this platform", SkipAll);
+#endif
+	}
+
+	QVERIFY(qobject_cast<EventDispatcherLibEvent*>(QAbstractEventDispatcher::instance()) != 0);
+}
+
+void tst_Allocations::cleanup(void)
+{
+	qDeleteAll(this->m_notifiers);
+	this->m_notifiers.clear();
+
+#ifndef Q_OS_WIN
+	for (int i=0; i<this->m_fds.size(); ++i) {
+		::close(this->m_fds.at(i));
+	}
+#endif
+
+	this->m_fds.clear();
+}
+
+void tst_Allocations::steadyState_data(void)
+{
+	QTest::addColumn<int>("sockets");
+	QTest::addColumn<int>("timers");
+	QTest::addColumn<bool>("excluding");
+	QTest::newRow("64 sockets") << 64 << 0 << false;
+	QTest::newRow("100 timers") << 0 << 100 << false;
+	QTest::newRow("64 sockets, 100 timers") << 64 << 100 << false;
+	QTest::newRow("500 sockets, 1000 timers") << 500 << 1000 << false;
+	QTest::newRow("64 sockets, 100 timers, excluding") << 64 << 100 << true;
+}
+
+/*
+ * Makes every watched descriptor readable and runs one iteration of the event loop
+ */
+long int tst_Allocations::iterate(bool count, QEventLoop::ProcessEventsFlags flags)
+{
+#ifndef Q_OS_WIN
+	for (int i=1; i<this->m_fds.size(); i+=2) {
+		::send(this->m_fds.at(i), "x", 1, 0);
+	}
+#endif
+
+	if (count) {
+		allocHooksStart();
+	}
+
+	QCoreApplication::processEvents(flags);
+	return count ? allocHooksStop() : 0;
+}
+
+/*
+ * Once the loop has warmed up (the queues and the tables have grown to the size the load needs),
+ * an iteration of processEvents() must not touch the heap, however many notifiers and timers fire.
+ * With `excluding`, every other iteration excludes socket notifiers or timers, so that the activations
+ * are suppressed and brought back over and over
+ */
+void tst_Allocations::steadyState(void)
+{
+#ifndef Q_OS_WIN
+	QFETCH(int, sockets);
+	QFETCH(int, timers);
+	QFETCH(bool, excluding);
+
+	static const QEventLoop::ProcessEventsFlag phases[4] = {
+		QEventLoop::AllEvents,
+		QEventLoop::ExcludeSocketNotifiers,
+		QEventLoop::AllEvents,
+		QEventLoop::X11ExcludeTimers
+	};
+
+	Reader reader;
+	for (int i=0; i<sockets; ++i) {
+		int sv[2];
+		QVERIFY(0 == ::socketpair(AF_UNIX, SOCK_STREAM, 0, sv));
+		this->m_fds << sv[0] << sv[1];
+
+		QSocketNotifier* n = new QSocketNotifier(sv[0], QSocketNotifier::Read);
+		QObject::connect(n, SIGNAL(activated(int)), &reader, SLOT(activated(int)));
+		this->m_notifiers.append(n);
+	}
+
+	// Zero-interval timers, precise ones (libevent's heap) and coarse ones (the timer wheel)
+	TimerCounter counter;
+	for (int i=0; i<timers; ++i) {
+		switch (i % 3) {
+			case 0:  counter.startTimer(0); break;
+			case 1:  counter.startTimer(1 + i % 5); break;
+			default: counter.startTimer(25 + i % 50); break;
+		}
+	}
+
+	int n = 0;
+	QElapsedTimer t;
+	t.start();
+	while (t.elapsed() < 300) {
+		this->iterate(false, excluding ? phases[n++ % 4] : QEventLoop::AllEvents);
+	}
+
+	reader.received = 0;
+	counter.fired   = 0;
+
+	long int allocations = 0;
+	t.start();
+	while (t.elapsed() < 300) {
+		allocations += this->iterate(true, excluding ? phases[n++ % 4] : QEventLoop::AllEvents);
+	}
+
+	QCOMPARE(allocations, 0L);
+	QVERIFY(!sockets || reader.received > 0);
+	QVERIFY(!timers  || counter.fired > 0);
+#endif
+}
+
+int main(int argc, char** argv)
+{
+#if QT_VERSION >= 0x050000
+	QCoreApplication::setEventDispatcher(new EventDispatcherLibEvent);
+#else
+	EventDispatcherLibEvent dispatcher;
+#endif
+	QCoreApplication app(argc, argv);
+	tst_Allocations tc;
+	return QTest::qExec(&tc, argc, argv);
+}
+
+#include "tst_allocations.moc"
@@ -0,0 +1,10 @@
+QT      -= gui
+QT      += testlib
+CONFIG  += console testcase
+CONFIG  -= app_bundle
+TARGET   = tst_migration
+DESTDIR  = ..
+
+SOURCES  = tst_migration.cpp
+
+include(../local.pri)
@@ -0,0 +1,316 @@
+#include <QtCore/QAtomicPointer>
+#include <QtCore/QCoreApplication>
+#include <QtCore/QElapsedTimer>
+#include <QtCore/QSemaphore>
+#include <QtCore/QSocketNotifier>
+#include <QtCore/QThread>
+#include <QtTest/QtTest>
+#include "eventdispatcher_libevent.h"
+
+#ifndef Q_OS_WIN
+#	include <sys/socket.h>
+#	include <unistd.h>
+#endif
+
+class Reader : public QObject {
+	Q_OBJECT
+public:
+	Reader(int fd)
+		: QObject(), notifier(new QSocketNotifier(fd, QSocketNotifier::Read, this)), read_thread(0), timer_thread(0), reads(), ticks()
+	{
+		QObject::connect(this->notifier, SIGNAL(activated(int)), this, SLOT(activated(int)));
+	}
+
+	QSocketNotifier* notifier;
+	QAtomicPointer<QThread> read_thread;  ///< Thread of the last notifier activation
+	QAtomicPointer<QThread> timer_thread; ///< Thread of the last timer event
+	QSemaphore reads;
+	QSemaphore ticks;
+
+public Q_SLOTS:
+	void activated(int fd)
+	{
+		char buf[16];
+		if (::recv(fd, buf, sizeof(buf), 0) > 0) {
+			this->read_thread.store(QThread::currentThread());
+			this->reads.release();
+		}
+	}
+
+protected:
+	virtual void timerEvent(QTimerEvent*)
+	{
+		this->timer_thread.store(QThread::currentThread());
+		this->ticks.release();
+	}
+};
+
+/*
+ * Counts activations and records the position of the first one in a sequence shared by several watchers;
+ * reads the data only if asked to, so that a level-triggered notifier keeps firing
+ */
+class Watcher : public QObject {
+	Q_OBJECT
+public:
+	Watcher(int fd, bool consume, QAtomicInt* sequence)
+		: QObject(), notifier(new QSocketNotifier(fd, QSocketNotifier::Read, this)), activations(0), order(-1), activated_sem(),
+		  m_consume(consume), m_sequence(sequence)
+	{
+		QObject::connect(this->notifier, SIGNAL(activated(int)), this, SLOT(activated(int)));
+	}
+
+	QSocketNotifier* notifier;
+	QAtomicInt activations;
+	QAtomicInt order;          ///< Position of the first activation in the sequence; -1 if there has been none
+	QSemaphore activated_sem;
+
+public Q_SLOTS:
+	void activated(int fd)
+	{
+		if (this->m_consume) {
+			char buf[16];
+			::recv(fd, buf, sizeof(buf), 0);
+		}
+
+		this->activations.ref();
+		if (this->m_sequence) {
+			this->order.testAndSetOrdered(-1, this->m_sequence->fetchAndAddOrdered(1));
+		}
+
+		this->activated_sem.release();
+	}
+
+private:
+	bool m_consume;
+	QAtomicInt* m_sequence;
+};
+
+/*
+ * Keeps the dispatcher's thread busy until the test opens the gate
+ */
+struct Gate {
+	QSemaphore entered;
+	QSemaphore open;
+};
+
+static void passGate(void* arg)
+{
+	Gate* gate = static_cast<Gate*>(arg);
+	gate->entered.release();
+	gate->open.acquire();
+}
+
+static void releaseSemaphore(void* arg)
+{
+	static_cast<QSemaphore*>(arg)->release();
+}
+
+class tst_Migration : public QObject {
+	Q_OBJECT
+private Q_SLOTS:
+	void init(void);
+	void cleanup(void);
+	void migrate(void);
+	void migrateWithParent(void);
+	void migrateEdgeTriggered(void);
+	void migratePriority(void);
+
+private:
+	QThread* m_thread;
+	EventDispatcherLibEvent* m_target;
+	int m_fds[2];
+
+	static EventDispatcherLibEvent* source(void);
+	static bool waitFor(QSemaphore& sem);
+};
+
+EventDispatcherLibEvent* tst_Migration::source(void)
+{
+	return qobject_cast<EventDispatcherLibEvent*>(QAbstractEventDispatcher::instance());
+}
+
+/*
+ * Runs the event loop of the main thread until @a sem can be acquired
+ */
+bool tst_Migration::waitFor(QSemaphore& sem)
+{
+	QElapsedTimer t;
+	t.start();
+	while (t.elapsed() < 5000) {
+		if (sem.tryAcquire()) {
+			return true;
+		}
+
+		QCoreApplication::processEvents(QEventLoop::AllEvents, 10);
+	}
+
+	return false;
+}
+
+void tst_Migration::init(void)
+{
+	this->m_fds[0] = this->m_fds[1] = -1;
+#ifndef Q_OS_WIN
+	QVERIFY(0 == ::socketpair(AF_UNIX, SOCK_STREAM, 0, this->m_fds));
+#else
+	QSKIP("The test needs socket pairs");
+#endif
+
+	QVERIFY(tst_Migration::source() != 0);
+
+	this->m_thread = new QThread;
+	this->m_target = new EventDispatcherLibEvent;
+	this->m_thread->setEventDispatcher(this->m_target);
+	this->m_thread->start();
+}
+
+void tst_Migration::cleanup(void)
+{
+	// QThread destroys its dispatcher
+	this->m_thread->quit();
+	this->m_thread->wait();
+	delete this->m_thread;
+
+#ifndef Q_OS_WIN
+	::close(this->m_fds[0]);
+	::close(this->m_fds[1]);
+#endif
+}
+
+/*
+ * The object, its socket notifier and its timer end up in the target thread and keep working there
+ */
+void tst_Migration::migrate(void)
+{
+#ifndef Q_OS_WIN
+	Reader* reader = new Reader(this->m_fds[0]);
+	reader->startTimer(10);
+
+	QSemaphore done;
+	QVERIFY(tst_Migration::source()->migrate(QList<QObject*>() << reader, this->m_target, releaseSemaphore, &done));
+	QVERIFY(tst_Migration::waitFor(done));
+
+	QCOMPARE(reader->thread(), this->m_thread);
+	QCOMPARE(reader->notifier->thread(), this->m_thread);
+
+	QCOMPARE(::send(this->m_fds[1], "x", 1, 0), ssize_t(1));
+	QVERIFY(reader->reads.tryAcquire(1, 5000));
+	QCOMPARE(reader->read_thread.load(), this->m_thread);
+
+	// A tick may have been delivered by the source thread before the migration
+	reader->ticks.acquire(reader->ticks.available());
+	QVERIFY(reader->ticks.tryAcquire(1, 5000));
+	QCOMPARE(reader->timer_thread.load(), this->m_thread);
+
+	// Destroyed when the thread finishes
+	reader->deleteLater();
+#endif
+}
+
+/*
+ * An object which cannot be moved stays in the source thread, and its notifier keeps working there
+ */
+void tst_Migration::migrateWithParent(void)
+{
+#ifndef Q_OS_WIN
+	QObject parent;
+	Reader* reader = new Reader(this->m_fds[0]);
+	reader->setParent(&parent);
+
+	QSemaphore done;
+	QVERIFY(tst_Migration::source()->migrate(QList<QObject*>() << reader, this->m_target, releaseSemaphore, &done));
+	QVERIFY(tst_Migration::waitFor(done));
+
+	QCOMPARE(reader->thread(), QThread::currentThread());
+	QCOMPARE(reader->notifier->thread(), QThread::currentThread());
+
+	QCOMPARE(::send(this->m_fds[1], "x", 1, 0), ssize_t(1));
+	QVERIFY(tst_Migration::waitFor(reader->reads));
+	QCOMPARE(reader->read_thread.load(), QThread::currentThread());
+#endif
+}
+
+/*
+ * The edge-triggered mode set in the source thread applies in the target thread:
+ * a notifier which does not read the data is activated once
+ */
+void tst_Migration::migrateEdgeTriggered(void)
+{
+#ifndef Q_OS_WIN
+	Watcher* watcher = new Watcher(this->m_fds[0], false, 0);
+	if (!tst_Migration::source()->setEdgeTriggered(watcher->notifier, true)) {
+		delete watcher;
+		QSKIP("The backend does not support edge-triggered events");
+	}
+
+	QSemaphore done;
+	QVERIFY(tst_Migration::source()->migrate(QList<QObject*>() << watcher, this->m_target, releaseSemaphore, &done));
+	QVERIFY(tst_Migration::waitFor(done));
+	QCOMPARE(watcher->thread(), this->m_thread);
+
+	QCOMPARE(::send(this->m_fds[1], "x", 1, 0), ssize_t(1));
+	QVERIFY(watcher->activated_sem.tryAcquire(1, 5000));
+
+	// A level-triggered notifier would have fired again by now
+	QTest::qSleep(200);
+	QCOMPARE(watcher->activations.load(), 1);
+
+	watcher->deleteLater();
+#endif
+}
+
+/*
+ * The priority classes set in the source thread apply in the target thread: of two descriptors
+ * which become readable during the same iteration, the high priority one is delivered first
+ */
+void tst_Migration::migratePriority(void)
+{
+#ifndef Q_OS_WIN
+	int fds[2];
+	QVERIFY(0 == ::socketpair(AF_UNIX, SOCK_STREAM, 0, fds));
+
+	QAtomicInt sequence(0);
+	Watcher* low  = new Watcher(this->m_fds[0], true, &sequence);
+	Watcher* high = new Watcher(fds[0], true, &sequence);
+	QVERIFY(tst_Migration::source()->setPriority(low->notifier, EventDispatcherLibEvent::LowPriority));
+	QVERIFY(tst_Migration::source()->setPriority(high->notifier, EventDispatcherLibEvent::HighPriority));
+
+	QSemaphore done;
+	QVERIFY(tst_Migration::source()->migrate(QList<QObject*>() << low << high, this->m_target, releaseSemaphore, &done));
+	QVERIFY(tst_Migration::waitFor(done));
+
+	// Both descriptors become readable while the target is busy, so that its next iteration collects them together
+	Gate gate;
+	QVERIFY(this->m_target->postTask(passGate, &gate));
+	bool entered = gate.entered.tryAcquire(1, 5000);
+	ssize_t sent = ::send(this->m_fds[1], "x", 1, 0) + ::send(fds[1], "x", 1, 0);
+	// Opened in any case: the thread could not be stopped otherwise
+	gate.open.release();
+	QVERIFY(entered);
+	QCOMPARE(sent, ssize_t(2));
+
+	QVERIFY(low->activated_sem.tryAcquire(1, 5000));
+	QVERIFY(high->activated_sem.tryAcquire(1, 5000));
+	QCOMPARE(high->order.load(), 0);
+	QCOMPARE(low->order.load(), 1);
+
+	// Destroyed when the thread finishes; the descriptor must outlive the notifier
+	low->deleteLater();
+	high->deleteLater();
+	this->m_thread->quit();
+	this->m_thread->wait();
+
+	::close(fds[0]);
+	::close(fds[1]);
+#endif
+}
+
+int main(int argc, char** argv)
+{
+	QCoreApplication::setEventDispatcher(new EventDispatcherLibEvent);
+	QCoreApplication app(argc, argv);
+	tst_Migration tc;
+	return QTest::qExec(&tc, argc, argv);
+}
+
+#include "tst_migration.moc"
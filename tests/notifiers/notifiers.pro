@@ -0,0 +1,10 @@
+QT      -= gui
+QT      += testlib
+CONFIG  += console testcase
+CONFIG  -= app_bundle
+TARGET   = tst_notifiers
+DESTDIR  = ..
+
+SOURCES  = tst_notifiers.cpp
+
+include(../local.pri)
@@ -0,0 +1,194 @@
+#include <QtCore/QCoreApplication>
+#include <QtCore/QElapsedTimer>
+#include <QtCore/QSocketNotifier>
+#include <QtTest/QtTest>
+#include "eventdispatcher_libevent.h"
+
+#ifndef Q_OS_WIN
+#	include <sys/socket.h>
+#	include <unistd.h>
+#endif
+
+/*
+ * Counts activations without consuming the data: a level-triggered notifier
+ * keeps firing, an edge-triggered one fires once per arrival. The position of the first
+ * activation is taken from @a sequence, shared by several counters
+ */
+class Counter : public QObject {
+	Q_OBJECT
+public:
+	Counter(int* sequence = 0) : QObject(), activations(0), order(-1), m_sequence(sequence) {}
+
+	int activations;
+	int order;
+
+public Q_SLOTS:
+	void activated(int)
+	{
+		if (!this->activations++ && this->m_sequence) {
+			this->order = (*this->m_sequence)++;
+		}
+	}
+
+private:
+	int* m_sequence;
+};
+
+class tst_Notifiers : public QObject {
+	Q_OBJECT
+private Q_SLOTS:
+	void init(void);
+	void cleanup(void);
+	void edgeTriggeredSurvivesToggle(void);
+	void edgeTriggeredNotInherited(void);
+	void prioritySurvivesToggle(void);
+
+private:
+	int m_fds[2];
+
+	static EventDispatcherLibEvent* dispatcher(void);
+	static void iterate(int msec);
+};
+
+EventDispatcherLibEvent* tst_Notifiers::dispatcher(void)
+{
+	return qobject_cast<EventDispatcherLibEvent*>(QAbstractEventDispatcher::instance());
+}
+
+void tst_Notifiers::iterate(int msec)
+{
+	QElapsedTimer t;
+	t.start();
+	while (t.elapsed() < msec) {
+		QCoreApplication::processEvents(QEventLoop::AllEvents, 10);
+	}
+}
+
+void tst_Notifiers::init(void)
+{
+	this->m_fds[0] = this->m_fds[1] = -1;
+#ifndef Q_OS_WIN
+	QVERIFY(0 == ::socketpair(AF_UNIX, SOCK_STREAM, 0, this->m_fds));
+#elif QT_VERSION >= 0x050000
+	QSKIP("The test needs socket pairs");
+#else
+	QSKIP("The test needs socket pairs", SkipAll);
+#endif
+
+	QVERIFY(tst_Notifiers::dispatcher() != 0);
+}
+
+void tst_Notifiers::cleanup(void)
+{
+#ifndef Q_OS_WIN
+	::close(this->m_fds[0]);
+	::close(this->m_fds[1]);
+#endif
+}
+
+/*
+ * Disabling and enabling the notifier back keeps the descriptor edge-triggered
+ */
+void tst_Notifiers::edgeTriggeredSurvivesToggle(void)
+{
+#ifndef Q_OS_WIN
+	Counter counter;
+	QSocketNotifier notifier(this->m_fds[0], QSocketNotifier::Read);
+	QObject::connect(&notifier, SIGNAL(activated(int)), &counter, SLOT(activated(int)));
+	if (!tst_Notifiers::dispatcher()->setEdgeTriggered(&notifier, true)) {
+#if QT_VERSION >= 0x050000
+		QSKIP("The backend does not support edge-triggered events");
+#else
+		QSKIP("The backend does not support edge-triggered events", SkipSingle);
+#endif
+	}
+
+	notifier.setEnabled(false);
+	tst_Notifiers::iterate(20);
+	notifier.setEnabled(true);
+
+	QCOMPARE(::send(this->m_fds[1], "x", 1, 0), ssize_t(1));
+	tst_Notifiers::iterate(200);
+	QCOMPARE(counter.activations, 1);
+#endif
+}
+
+/*
+ * A new notifier on the descriptor of a parked edge-triggered one starts level-triggered
+ */
+void tst_Notifiers::edgeTriggeredNotInherited(void)
+{
+#ifndef Q_OS_WIN
+	QSocketNotifier previous(this->m_fds[0], QSocketNotifier::Read);
+	if (!tst_Notifiers::dispatcher()->setEdgeTriggered(&previous, true)) {
+#if QT_VERSION >= 0x050000
+		QSKIP("The backend does not support edge-triggered events");
+#else
+		QSKIP("The backend does not support edge-triggered events", SkipSingle);
+#endif
+	}
+
+	// Kept alive, so that the new notifier cannot reuse its address
+	previous.setEnabled(false);
+
+	Counter counter;
+	QSocketNotifier notifier(this->m_fds[0], QSocketNotifier::Read);
+	QObject::connect(&notifier, SIGNAL(activated(int)), &counter, SLOT(activated(int)));
+
+	QCOMPARE(::send(this->m_fds[1], "x", 1, 0), ssize_t(1));
+	tst_Notifiers::iterate(200);
+	QVERIFY(counter.activations > 1);
+#endif
+}
+
+/*
+ * Disabling and enabling the notifier back keeps its priority class: of two descriptors
+ * which are ready at the same time, the high priority one is delivered first
+ */
+void tst_Notifiers::prioritySurvivesToggle(void)
+{
+#ifndef Q_OS_WIN
+	int fds[2];
+	QVERIFY(0 == ::socketpair(AF_UNIX, SOCK_STREAM, 0, fds));
+
+	int sequence = 0;
+	Counter normal(&sequence);
+	Counter high(&sequence);
+	QSocketNotifier normal_notifier(this->m_fds[0], QSocketNotifier::Read);
+	QSocketNotifier high_notifier(fds[0], QSocketNotifier::Read);
+	QObject::connect(&normal_notifier, SIGNAL(activated(int)), &normal, SLOT(activated(int)));
+	QObject::connect(&high_notifier, SIGNAL(activated(int)), &high, SLOT(activated(int)));
+	QVERIFY(tst_Notifiers::dispatcher()->setPriority(&high_notifier, EventDispatcherLibEvent::HighPriority));
+
+	high_notifier.setEnabled(false);
+	tst_Notifiers::iterate(20);
+	high_notifier.setEnabled(true);
+
+	// Both descriptors are ready before the next iteration collects them
+	QCOMPARE(::send(this->m_fds[1], "x", 1, 0), ssize_t(1));
+	QCOMPARE(::send(fds[1], "x", 1, 0), ssize_t(1));
+	tst_Notifiers::iterate(50);
+
+	high_notifier.setEnabled(false);
+	normal_notifier.setEnabled(false);
+	::close(fds[0]);
+	::close(fds[1]);
+
+	QCOMPARE(high.order, 0);
+	QCOMPARE(normal.order, 1);
+#endif
+}
+
+int main(int argc, char** argv)
+{
+#if QT_VERSION >= 0x050000
+	QCoreApplication::setEventDispatcher(new EventDispatcherLibEvent);
+#else
+	EventDispatcherLibEvent dispatcher;
+#endif
+	QCoreApplication app(argc, argv);
+	tst_Notifiers tc;
+	return QTest::qExec(&tc, argc, argv);
+}
+
+#include "tst_notifiers.moc"
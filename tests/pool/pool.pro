@@ -0,0 +1,10 @@
+QT      -= gui
+QT      += testlib
+CONFIG  += console testcase
+CONFIG  -= app_bundle
+TARGET   = tst_pool
+DESTDIR  = ..
+
+SOURCES  = tst_pool.cpp
+
+include(../local.pri)
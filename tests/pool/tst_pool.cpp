@@ -0,0 +1,232 @@
+#include <QtCore/QCoreApplication>
+#include <QtCore/QMutex>
+#include <QtCore/QMutexLocker>
+#include <QtCore/QSemaphore>
+#include <QtCore/QThread>
+#include <QtCore/QVector>
+#include <QtTest/QtTest>
+#include "eventdispatcher_libevent.h"
+#include "eventdispatcher_libevent_pool.h"
+
+#ifndef Q_OS_WIN
+#	include <arpa/inet.h>
+#	include <netinet/in.h>
+#	include <sys/socket.h>
+#	include <unistd.h>
+#endif
+
+struct AcceptLog {
+	EventDispatcherLibEventPool* pool;
+	QMutex lock;
+	QVector<int> fds;
+	QVector<int> indices;
+	int wrong_thread;
+	QSemaphore accepted;
+
+	AcceptLog(void) : pool(0), lock(), fds(), indices(), wrong_thread(0), accepted() {}
+};
+
+static void acceptHandler(qintptr fd, int index, void* context)
+{
+	AcceptLog* log = static_cast<AcceptLog*>(context);
+
+	// The handler runs in the event loop of the accepting thread, not in a libevent callback:
+	// nested event loops must work
+	QCoreApplication::processEvents();
+
+	QMutexLocker locker(&log->lock);
+	if (QThread::currentThread() != log->pool->threadAt(index)) {
+		++log->wrong_thread;
+	}
+
+	log->fds.append(int(fd));
+	log->indices.append(index);
+	locker.unlock();
+
+	log->accepted.release();
+}
+
+class tst_Pool : public QObject {
+	Q_OBJECT
+private Q_SLOTS:
+	void startStop(void);
+	void acceptConnections_data(void);
+	void acceptConnections(void);
+
+private:
+	static int freePort(void);
+	static int connectTo(int port);
+};
+
+/*
+ * Finds a TCP port nobody listens on
+ */
+int tst_Pool::freePort(void)
+{
+#ifndef Q_OS_WIN
+	int fd = ::socket(AF_INET, SOCK_STREAM, 0);
+	if (-1 == fd) {
+		return -1;
+	}
+
+	struct sockaddr_in sin;
+	socklen_t len = sizeof(sin);
+	memset(&sin, 0, sizeof(sin));
+	sin.sin_family      = AF_INET;
+	sin.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+	int port = -1;
+	if (0 == ::bind(fd, reinterpret_cast<struct sockaddr*>(&sin), sizeof(sin)) && 0 == ::getsockname(fd, reinterpret_cast<struct sockaddr*>(&sin), &len)) {
+		port = ntohs(sin.sin_port);
+	}
+
+	::close(fd);
+	return port;
+#else
+	return -1;
+#endif
+}
+
+/*
+ * Opens a connection to the loopback address; returns the socket or -1
+ */
+int tst_Pool::connectTo(int port)
+{
+#ifndef Q_OS_WIN
+	int fd = ::socket(AF_INET, SOCK_STREAM, 0);
+	if (-1 == fd) {
+		return -1;
+	}
+
+	struct sockaddr_in sin;
+	memset(&sin, 0, sizeof(sin));
+	sin.sin_family      = AF_INET;
+	sin.sin_port        = htons(port);
+	sin.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+	if (-1 == ::connect(fd, reinterpret_cast<struct sockaddr*>(&sin), sizeof(sin))) {
+		::close(fd);
+		return -1;
+	}
+
+	return fd;
+#else
+	Q_UNUSED(port)
+	return -1;
+#endif
+}
+
+void tst_Pool::startStop(void)
+{
+	EventDispatcherLibEventPool pool(3);
+	QCOMPARE(pool.size(), 3);
+	QVERIFY(!pool.isRunning());
+
+	QVERIFY(pool.start());
+	QVERIFY(pool.isRunning());
+	QVERIFY(!pool.start());
+	QVERIFY(!pool.setWorkStealing(true));
+
+	for (int i=0; i<pool.size(); ++i) {
+		QVERIFY(pool.threadAt(i) != 0);
+		QVERIFY(pool.threadAt(i)->isRunning());
+		QVERIFY(pool.dispatcherAt(i) != 0);
+		QCOMPARE(pool.threadAt(i)->eventDispatcher(), static_cast<QAbstractEventDispatcher*>(pool.dispatcherAt(i)));
+	}
+
+	QVERIFY(pool.threadAt(3) == 0);
+	QVERIFY(pool.dispatcherAt(-1) == 0);
+
+	pool.stop();
+	QVERIFY(!pool.isRunning());
+	for (int i=0; i<pool.size(); ++i) {
+		QVERIFY(pool.threadAt(i)->isFinished());
+		QVERIFY(pool.dispatcherAt(i) == 0);
+	}
+
+	QVERIFY(!pool.start());
+}
+
+void tst_Pool::acceptConnections_data(void)
+{
+	QTest::addColumn<int>("mode");
+	QTest::addColumn<bool>("listenFirst");
+	QTest::newRow("ReusePort, before start()") << int(EventDispatcherLibEventPool::ReusePort) << true;
+	QTest::newRow("ReusePort, after start()") << int(EventDispatcherLibEventPool::ReusePort) << false;
+	QTest::newRow("Shared, before start()") << int(EventDispatcherLibEventPool::Shared) << true;
+	QTest::newRow("Shared, after start()") << int(EventDispatcherLibEventPool::Shared) << false;
+}
+
+/*
+ * Connections are accepted by the pool threads and handed to the handler in the accepting thread;
+ * stop() closes the listening sockets
+ */
+void tst_Pool::acceptConnections(void)
+{
+#ifndef Q_OS_WIN
+	QFETCH(int, mode);
+	QFETCH(bool, listenFirst);
+
+	static const int connections = 16;
+
+	int port = tst_Pool::freePort();
+	QVERIFY(port > 0);
+
+	// The log outlives the pool, whose threads may still call the handler when a check fails
+	AcceptLog log;
+	EventDispatcherLibEventPool pool(2);
+	log.pool = &pool;
+
+	QByteArray address = "127.0.0.1:" + QByteArray::number(port);
+	if (listenFirst) {
+		if (!pool.listen(address, acceptHandler, &log, EventDispatcherLibEventPool::ListenMode(mode))) {
+			QSKIP("Cannot listen in this mode on this platform");
+		}
+
+		QVERIFY(pool.start());
+	}
+	else {
+		QVERIFY(pool.start());
+		if (!pool.listen(address, acceptHandler, &log, EventDispatcherLibEventPool::ListenMode(mode))) {
+			QSKIP("Cannot listen in this mode on this platform");
+		}
+	}
+
+	QVector<int> clients;
+	for (int i=0; i<connections; ++i) {
+		int fd = tst_Pool::connectTo(port);
+		QVERIFY(fd != -1);
+		clients.append(fd);
+	}
+
+	QVERIFY(log.accepted.tryAcquire(connections, 5000));
+	QCOMPARE(log.wrong_thread, 0);
+	QCOMPARE(log.fds.size(), connections);
+	QCOMPARE(pool.connectionCount(0) + pool.connectionCount(1), connections);
+
+	for (int i=0; i<log.fds.size(); ++i) {
+		::close(log.fds.at(i));
+		pool.connectionClosed(log.indices.at(i));
+	}
+
+	QCOMPARE(pool.connectionCount(0), 0);
+	QCOMPARE(pool.connectionCount(1), 0);
+
+	for (int i=0; i<clients.size(); ++i) {
+		::close(clients.at(i));
+	}
+
+	pool.stop();
+	QCOMPARE(tst_Pool::connectTo(port), -1);
+#endif
+}
+
+int main(int argc, char** argv)
+{
+	QCoreApplication::setEventDispatcher(new EventDispatcherLibEvent);
+	QCoreApplication app(argc, argv);
+	tst_Pool tc;
+	return QTest::qExec(&tc, argc, argv);
+}
+
+#include "tst_pool.moc"
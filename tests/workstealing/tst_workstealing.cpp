@@ -0,0 +1,195 @@
+#include <QtCore/QAtomicInt>
+#include <QtCore/QAtomicPointer>
+#include <QtCore/QCoreApplication>
+#include <QtCore/QElapsedTimer>
+#include <QtCore/QSemaphore>
+#include <QtCore/QSharedPointer>
+#include <QtCore/QThread>
+#include <QtTest/QtTest>
+#include "eventdispatcher_libevent.h"
+
+enum { MaxTasks = 500 };
+
+struct TaskLog {
+	QAtomicInt runs[MaxTasks];     ///< How many times each task has been run
+	QAtomicInt released[MaxTasks]; ///< How many times each task has been destroyed, either after it ran or unrun
+	QAtomicPointer<QThread> threads[MaxTasks];
+	QSemaphore done;
+};
+
+struct Ticket {
+	TaskLog* log;
+	int id;
+
+	Ticket(TaskLog* l, int i) : log(l), id(i) {}
+};
+
+static void releaseTicket(Ticket* ticket)
+{
+	ticket->log->released[ticket->id].ref();
+	delete ticket;
+}
+
+/*
+ * Copies of the task share the ticket, which is released when the dispatcher
+ * destroys its copy of the task, whether it has been run or discarded
+ */
+class StealableTask {
+public:
+	StealableTask(TaskLog* log, int id, int usec) : m_ticket(new Ticket(log, id), releaseTicket), m_usec(usec) {}
+
+	void operator()(void)
+	{
+		QElapsedTimer t;
+		t.start();
+		while (t.nsecsElapsed() < qint64(this->m_usec) * 1000) {
+		}
+
+		TaskLog* log = this->m_ticket->log;
+		int id       = this->m_ticket->id;
+		log->threads[id].store(QThread::currentThread());
+		log->runs[id].ref();
+		log->done.release();
+	}
+
+private:
+	QSharedPointer<Ticket> m_ticket;
+	int m_usec;
+};
+
+struct Gate {
+	QSemaphore entered;
+	QSemaphore open;
+};
+
+static void blockOnGate(void* arg)
+{
+	Gate* gate = static_cast<Gate*>(arg);
+	gate->entered.release();
+	gate->open.acquire();
+}
+
+class tst_WorkStealing : public QObject {
+	Q_OBJECT
+private Q_SLOTS:
+	void init(void);
+	void cleanup(void);
+	void idlePeerStealsFromBusyDispatcher(void);
+	void leaveGroupOnDestruction(void);
+
+private:
+	QThread* m_threads[2];
+	EventDispatcherLibEvent* m_dispatchers[2];
+
+	void stopThread(int idx);
+};
+
+void tst_WorkStealing::init(void)
+{
+	this->m_threads[0]     = this->m_threads[1]     = 0;
+	this->m_dispatchers[0] = this->m_dispatchers[1] = 0;
+
+#ifndef Q_COMPILER_LAMBDA
+	QSKIP("Stealable functors need a compiler with lambda support");
+#endif
+
+	QList<EventDispatcherLibEvent*> group;
+	for (int i=0; i<2; ++i) {
+		this->m_threads[i]     = new QThread;
+		this->m_dispatchers[i] = new EventDispatcherLibEvent;
+		this->m_threads[i]->setEventDispatcher(this->m_dispatchers[i]);
+		group.append(this->m_dispatchers[i]);
+	}
+
+	EventDispatcherLibEvent::enableWorkStealing(group);
+
+	for (int i=0; i<2; ++i) {
+		this->m_threads[i]->start();
+	}
+}
+
+void tst_WorkStealing::cleanup(void)
+{
+	for (int i=0; i<2; ++i) {
+		this->stopThread(i);
+	}
+}
+
+/*
+ * QThread destroys the dispatcher when the thread finishes
+ */
+void tst_WorkStealing::stopThread(int idx)
+{
+	if (this->m_threads[idx]) {
+		this->m_threads[idx]->quit();
+		this->m_threads[idx]->wait();
+		delete this->m_threads[idx];
+		this->m_threads[idx]     = 0;
+		this->m_dispatchers[idx] = 0;
+	}
+}
+
+/*
+ * While the first dispatcher is stuck in a long task, its stealable tasks are run by the idle peer
+ */
+void tst_WorkStealing::idlePeerStealsFromBusyDispatcher(void)
+{
+#ifdef Q_COMPILER_LAMBDA
+	static const int tasks = 16;
+
+	Gate gate;
+	QVERIFY(this->m_dispatchers[0]->postTask(blockOnGate, &gate));
+	QVERIFY(gate.entered.tryAcquire(1, 5000));
+
+	TaskLog log;
+	for (int i=0; i<tasks; ++i) {
+		QVERIFY(this->m_dispatchers[0]->postStealableTask(StealableTask(&log, i, 0)));
+	}
+
+	bool finished = log.done.tryAcquire(tasks, 5000);
+	gate.open.release();
+	QVERIFY(finished);
+
+	for (int i=0; i<tasks; ++i) {
+		QCOMPARE(log.runs[i].load(), 1);
+		QCOMPARE(log.threads[i].load(), this->m_threads[1]);
+	}
+#endif
+}
+
+/*
+ * A dispatcher destroyed while its peer is stealing from it: every task is either run or discarded, exactly once
+ */
+void tst_WorkStealing::leaveGroupOnDestruction(void)
+{
+#ifdef Q_COMPILER_LAMBDA
+	TaskLog log;
+	for (int i=0; i<MaxTasks; ++i) {
+		QVERIFY(this->m_dispatchers[0]->postStealableTask(StealableTask(&log, i, 50)));
+	}
+
+	// Let both dispatchers run a share of the tasks, then destroy the first one in the middle of it
+	QVERIFY(log.done.tryAcquire(MaxTasks / 10, 5000));
+	this->stopThread(0);
+	this->stopThread(1);
+
+	int run = 0;
+	for (int i=0; i<MaxTasks; ++i) {
+		QVERIFY(log.runs[i].load() <= 1);
+		QCOMPARE(log.released[i].load(), 1);
+		run += log.runs[i].load();
+	}
+
+	QVERIFY(run >= MaxTasks / 10);
+#endif
+}
+
+int main(int argc, char** argv)
+{
+	QCoreApplication::setEventDispatcher(new EventDispatcherLibEvent);
+	QCoreApplication app(argc, argv);
+	tst_WorkStealing tc;
+	return QTest::qExec(&tc, argc, argv);
+}
+
+#include "tst_workstealing.moc"
@@ -0,0 +1,10 @@
+QT      -= gui
+QT      += testlib
+CONFIG  += console testcase
+CONFIG  -= app_bundle
+TARGET   = tst_workstealing
+DESTDIR  = ..
+
+SOURCES  = tst_workstealing.cpp
+
+include(../local.pri)